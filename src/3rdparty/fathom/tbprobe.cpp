@@ -50,12 +50,6 @@
 
 #define TB_MAX_CAPTURES             64
 
-#define TB_LOSS                     0       /* LOSS */
-#define TB_BLESSED_LOSS             1       /* LOSS but 50-move draw */
-#define TB_DRAW                     2       /* DRAW */
-#define TB_CURSED_WIN               3       /* WIN but 50-move draw  */
-#define TB_WIN                      4       /* WIN  */
-
 #define TB_PROMOTES_NONE            0
 #define TB_PROMOTES_QUEEN           1
 #define TB_PROMOTES_ROOK            2
@@ -67,13 +61,13 @@
 #define TB_RESULT_FROM_MASK         0x0000FC00
 #define TB_RESULT_PROMOTES_MASK     0x00070000
 #define TB_RESULT_EP_MASK           0x00080000
-#define TB_RESULT_DTZ_MASK          0xFFF00000
+//#define TB_RESULT_DTZ_MASK          0xFFF00000
 //#define TB_RESULT_WDL_SHIFT         0
 #define TB_RESULT_TO_SHIFT          4
 #define TB_RESULT_FROM_SHIFT        10
 #define TB_RESULT_PROMOTES_SHIFT    16
 #define TB_RESULT_EP_SHIFT          19
-#define TB_RESULT_DTZ_SHIFT         20
+//#define TB_RESULT_DTZ_SHIFT         20
 
 #define TB_GET_TO(_res)                         \
 (((_res) & TB_RESULT_TO_MASK) >> TB_RESULT_TO_SHIFT)
@@ -83,8 +77,6 @@
 (((_res) & TB_RESULT_PROMOTES_MASK) >> TB_RESULT_PROMOTES_SHIFT)
 #define TB_GET_EP(_res)                         \
 (((_res) & TB_RESULT_EP_MASK) >> TB_RESULT_EP_SHIFT)
-#define TB_GET_DTZ(_res)                        \
-(((_res) & TB_RESULT_DTZ_MASK) >> TB_RESULT_DTZ_SHIFT)
 
 #define TB_SET_WDL(_res, _wdl)                  \
 (((_res) & ~TB_RESULT_WDL_MASK) |           \
@@ -135,20 +127,12 @@ typedef HANDLE map_t;
 // Threading support
 #ifndef TB_NO_THREADS
 
-#include <mutex>
-#define LOCK_T std::mutex
-#define LOCK_INIT(x)
-#define LOCK_DESTROY(x)
-#define LOCK(x) x.lock()
-#define UNLOCK(x) x.unlock()
+#include <thread>
+#define TB_YIELD() std::this_thread::yield()
 
 #else /* TB_NO_THREADS */
 
-#define LOCK_T          int
-#define LOCK_INIT(x)    /* NOP */
-#define LOCK_DESTROY(x) /* NOP */
-#define LOCK(x)         /* NOP */
-#define UNLOCK(x)       /* NOP */
+#define TB_YIELD()      /* NOP */
 #endif
 
 // population count implementation
@@ -319,14 +303,10 @@ static size_t file_size(FD fd) {
 #endif
 }
 
-#ifndef TB_NO_THREADS
-static LOCK_T tbMutex;
-#endif
-
-
 using namespace Tablebase;
 
 static int initialized = 0;
+static bool lazyMode = false;
 static std::string pathString;
 static std::vector<std::string> paths;
 static int missingCnt = 0;
@@ -469,12 +449,17 @@ struct EncInfo {
     uint8_t norm[TB_PIECES];
 };
 
+// Tables are initialized (mapped) once, by the first thread which needs them
+enum TableState {
+    TABLE_NONE, TABLE_INITIALIZING, TABLE_READY, TABLE_FAILED
+};
+
 struct BaseEntry {
     uint64_t key;
     uint8_t *data[3];
     map_t mapping[3];
     
-    std::atomic<bool> ready[3];
+    std::atomic<int> state[3]; // TableState
     
     uint8_t num;
     bool symmetric, hasPawns, hasDtm, hasDtz;
@@ -752,7 +737,8 @@ static void add_to_hash(struct BaseEntry *ptr, uint64_t key)
 
 void SyzygyTablebase::init_tb(const std::string& str)
 {
-    if (!test_tb(str, tbSuffix[WDL])) {
+    // lazy mode: files are checked and mapped only when a game needs them
+    if (!lazyMode && !test_tb(str, tbSuffix[WDL])) {
         missingVec.push_back(str);
         return;
     }
@@ -785,20 +771,24 @@ void SyzygyTablebase::init_tb(const std::string& str)
     for (int i = 0; i < 16; i++)
         be->num += pcs[i];
     
-    numWdl++;
-    numDtm += be->hasDtm = test_tb(str, tbSuffix[DTM]);
-    numDtz += be->hasDtz = test_tb(str, tbSuffix[DTZ]);
-    
-    if (be->num > TB_MaxCardinality) {
-        TB_MaxCardinality = be->num;
-    }
-    if (be->hasDtm)
-        if (be->num > TB_MaxCardinalityDTM) {
-            TB_MaxCardinalityDTM = be->num;
+    if (lazyMode) {
+        be->hasDtm = be->hasDtz = true;
+    } else {
+        numWdl++;
+        numDtm += be->hasDtm = test_tb(str, tbSuffix[DTM]);
+        numDtz += be->hasDtz = test_tb(str, tbSuffix[DTZ]);
+        
+        if (be->num > TB_MaxCardinality) {
+            TB_MaxCardinality = be->num;
         }
+        if (be->hasDtm)
+            if (be->num > TB_MaxCardinalityDTM) {
+                TB_MaxCardinalityDTM = be->num;
+            }
+    }
     
     for (int type = 0; type < 3; type++)
-        atomic_init(&be->ready[type], false);
+        atomic_init(&be->state[type], (int)TABLE_NONE);
     
     if (!be->hasPawns) {
         int j = 0;
@@ -835,7 +825,7 @@ struct EncInfo *first_ei(struct BaseEntry *be, const int type)
 static void free_tb_entry(struct BaseEntry *be)
 {
     for (int type = 0; type < 3; type++) {
-        if (atomic_load_explicit(&be->ready[type], std::memory_order_relaxed)) {
+        if (atomic_load_explicit(&be->state[type], std::memory_order_relaxed) == TABLE_READY) {
             unmap_file((void*)(be->data[type]), be->mapping[type]);
             int num = num_tables(be, type);
             struct EncInfo *ei = first_ei(be, type);
@@ -844,8 +834,8 @@ static void free_tb_entry(struct BaseEntry *be)
                 if (type != DTZ)
                     free(ei[num + t].precomp);
             }
-            atomic_store_explicit(&be->ready[type], false, std::memory_order_relaxed);
         }
+        atomic_store_explicit(&be->state[type], (int)TABLE_NONE, std::memory_order_relaxed);
     }
 }
 
@@ -862,7 +852,7 @@ std::vector<std::string> splitString(const std::string &s, char delim)
     return elems;
 }
 
-bool SyzygyTablebase::tb_init(const std::string& path)
+bool SyzygyTablebase::tb_init(const std::string& path, bool lazy)
 {
     if (!initialized) {
         init_indices();
@@ -882,8 +872,6 @@ bool SyzygyTablebase::tb_init(const std::string& path)
         for (int i = 0; i < tbNumPawn; i++)
             free_tb_entry((struct BaseEntry *)&pawnEntry[i]);
         
-        LOCK_DESTROY(tbMutex);
-        
         pathString.clear();
         numWdl = numDtm = numDtz = 0;
     }
@@ -894,8 +882,8 @@ bool SyzygyTablebase::tb_init(const std::string& path)
     
     pathString = path;
     paths = splitString(pathString, SEP_CHAR);
-    
-    LOCK_INIT(tbMutex);
+    lazyMode = lazy;
+    missingVec.clear();
     
     tbNumPiece = tbNumPawn = 0;
     TB_MaxCardinality = TB_MaxCardinalityDTM = 0;
@@ -1029,6 +1017,11 @@ bool SyzygyTablebase::tb_init(const std::string& path)
         TB_LARGEST = TB_MaxCardinalityDTM;
     }
     
+    // nothing is known about files yet
+    if (lazyMode) {
+        TB_LARGEST = TB_MaxCardinality = TB_PIECES;
+    }
+    
     missingCnt = 0;
     if (!missingVec.empty()) {
         for(auto && s : missingVec) {
@@ -1043,7 +1036,11 @@ bool SyzygyTablebase::tb_init(const std::string& path)
 std::string SyzygyTablebase::toString()
 {
     std::ostringstream stringStream;
-    stringStream << "Syzygy endgames: " << numWdl << ", pieces: " << TB_LARGEST << ", missing: " << missingCnt << "; ";
+    if (lazyMode) {
+        stringStream << "Syzygy endgames: lazy loading, pieces: up to " << TB_LARGEST << "; ";
+    } else {
+        stringStream << "Syzygy endgames: " << numWdl << ", pieces: " << TB_LARGEST << ", missing: " << missingCnt << "; ";
+    }
     return stringStream.str();
 }
 
@@ -1796,21 +1793,27 @@ int probe_table(const Pos *pos, int s, int *success, const int type)
         return 0;
     }
     
-    // Use double-checked locking to reduce locking overhead
-    if (!atomic_load_explicit(&be->ready[type], std::memory_order_acquire)) {
-        LOCK(tbMutex);
-        if (!atomic_load_explicit(&be->ready[type], std::memory_order_relaxed)) {
+    // Only the thread which wins the state change initializes the table,
+    // others (needing the same table) wait, without any global lock
+    int state = atomic_load_explicit(&be->state[type], std::memory_order_acquire);
+    if (state != TABLE_READY) {
+        int expected = TABLE_NONE;
+        if (state == TABLE_NONE
+            && be->state[type].compare_exchange_strong(expected, (int)TABLE_INITIALIZING, std::memory_order_acq_rel)) {
             char str[16];
             prt_str(pos, str, be->key != key);
-            if (!init_table(be, str, type)) {
-                tbHash[hashIdx].ptr = NULL; // mark as deleted
-                *success = 0;
-                UNLOCK(tbMutex);
-                return 0;
-            }
-            atomic_store_explicit(&be->ready[type], true, std::memory_order_release);
+            state = init_table(be, str, type) ? TABLE_READY : TABLE_FAILED;
+            atomic_store_explicit(&be->state[type], state, std::memory_order_release);
+        }
+        
+        while ((state = atomic_load_explicit(&be->state[type], std::memory_order_acquire)) == TABLE_INITIALIZING) {
+            TB_YIELD();
+        }
+        
+        if (state != TABLE_READY) {
+            *success = 0;
+            return 0;
         }
-        UNLOCK(tbMutex);
     }
     
     bool bside, flip;
@@ -47,11 +47,21 @@ namespace Tablebase {
 #define TB_CASTLING_k               0x4     /* Black king-side. */
 #define TB_CASTLING_q               0x8     /* Black queen-side. */
     
+#define TB_LOSS                     0       /* LOSS */
+#define TB_BLESSED_LOSS             1       /* LOSS but 50-move draw */
+#define TB_DRAW                     2       /* DRAW */
+#define TB_CURSED_WIN               3       /* WIN but 50-move draw  */
+#define TB_WIN                      4       /* WIN  */
+    
 #define TB_RESULT_WDL_MASK          0x0000000F
+#define TB_RESULT_DTZ_MASK          0xFFF00000
 #define TB_RESULT_WDL_SHIFT         0
+#define TB_RESULT_DTZ_SHIFT         20
     
 #define TB_GET_WDL(_res)                        \
 (((_res) & TB_RESULT_WDL_MASK) >> TB_RESULT_WDL_SHIFT)
+#define TB_GET_DTZ(_res)                        \
+(((_res) & TB_RESULT_DTZ_MASK) >> TB_RESULT_DTZ_SHIFT)
 #define TB_RESULT_FAILED            0xFFFFFFFF
     
     class SyzygyTablebase
@@ -67,13 +77,16 @@ namespace Tablebase {
          * PARAMETERS:
          * - path:
          *   The tablebase PATH string.
+         * - lazy:
+         *   Don't check files now, they are opened and mapped at the first probes
+         *   for their material.  TB_LARGEST is then set to the supported maximum.
          *
          * RETURN:
          * - true=succes, false=failed.  The TB_LARGEST global will also be
          *   initialized.  If no tablebase files are found, then `true' is returned
          *   and TB_LARGEST is set to zero.
          */
-        static bool tb_init(const std::string& path);
+        static bool tb_init(const std::string& path, bool lazy = false);
         
         /*
          * Free any resources allocated by tb_init
@@ -146,6 +159,52 @@ namespace Tablebase {
                                       _bishops, _knights, _pawns, _rule50, _ep, _turn, _results);
         }
         
+        /*
+         * Probe the Win-Draw-Loss (WDL) table.
+         *
+         * PARAMETERS:
+         * - white, black, kings, queens, rooks, bishops, knights, pawns:
+         *   The current position (bitboards).
+         * - rule50:
+         *   The 50-move half-move clock.
+         * - castling:
+         *   Castling rights.  Set to zero if no castling is possible.
+         * - ep:
+         *   The en passant square (if exists).  Set to zero if there is no en passant
+         *   square.
+         * - turn:
+         *   true=white, false=black
+         *
+         * RETURN:
+         * - One of {TB_LOSS, TB_BLESSED_LOSS, TB_DRAW, TB_CURSED_WIN, TB_WIN}.
+         *   Otherwise returns TB_RESULT_FAILED if the probe failed.
+         *
+         * NOTES:
+         * - Engines should use this function during search.
+         * - This function is thread safe assuming TB_NO_THREADS is disabled.
+         */
+        static inline unsigned tb_probe_wdl(
+                                            uint64_t _white,
+                                            uint64_t _black,
+                                            uint64_t _kings,
+                                            uint64_t _queens,
+                                            uint64_t _rooks,
+                                            uint64_t _bishops,
+                                            uint64_t _knights,
+                                            uint64_t _pawns,
+                                            unsigned _rule50,
+                                            unsigned _castling,
+                                            unsigned _ep,
+                                            bool     _turn)
+        {
+            if (_castling != 0)
+                return TB_RESULT_FAILED;
+            if (_rule50 != 0)
+                return TB_RESULT_FAILED;
+            return tb_probe_wdl_impl(_white, _black, _kings, _queens, _rooks,
+                                     _bishops, _knights, _pawns, _ep, _turn);
+        }
+        
     private:
         /*
          * Use the DTZ tables to rank and score all root moves.
@@ -229,52 +288,6 @@ namespace Tablebase {
                                            bool     _turn,
                                            unsigned *_results);
         
-        /*
-         * Probe the Win-Draw-Loss (WDL) table.
-         *
-         * PARAMETERS:
-         * - white, black, kings, queens, rooks, bishops, knights, pawns:
-         *   The current position (bitboards).
-         * - rule50:
-         *   The 50-move half-move clock.
-         * - castling:
-         *   Castling rights.  Set to zero if no castling is possible.
-         * - ep:
-         *   The en passant square (if exists).  Set to zero if there is no en passant
-         *   square.
-         * - turn:
-         *   true=white, false=black
-         *
-         * RETURN:
-         * - One of {TB_LOSS, TB_BLESSED_LOSS, TB_DRAW, TB_CURSED_WIN, TB_WIN}.
-         *   Otherwise returns TB_RESULT_FAILED if the probe failed.
-         *
-         * NOTES:
-         * - Engines should use this function during search.
-         * - This function is thread safe assuming TB_NO_THREADS is disabled.
-         */
-        static inline unsigned tb_probe_wdl(
-                                            uint64_t _white,
-                                            uint64_t _black,
-                                            uint64_t _kings,
-                                            uint64_t _queens,
-                                            uint64_t _rooks,
-                                            uint64_t _bishops,
-                                            uint64_t _knights,
-                                            uint64_t _pawns,
-                                            unsigned _rule50,
-                                            unsigned _castling,
-                                            unsigned _ep,
-                                            bool     _turn)
-        {
-            if (_castling != 0)
-                return TB_RESULT_FAILED;
-            if (_rule50 != 0)
-                return TB_RESULT_FAILED;
-            return tb_probe_wdl_impl(_white, _black, _kings, _queens, _rooks,
-                                     _bishops, _knights, _pawns, _ep, _turn);
-        }
-        
     };
     
     
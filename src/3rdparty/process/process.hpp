@@ -16,8 +16,15 @@ namespace TinyProcessLib {
 struct Config {
   /// Buffer size for reading stdout and stderr. Default is 131072 (128 kB).
   std::size_t buffer_size = 131072;
+  /// Capacity of the stdout pipe, zero for the system default. Only supported on Linux.
+  std::size_t pipe_size = 0;
+  /// Set to true to never block on writing to stdin, data the process can't take yet is kept
+  /// and sent by later writes or flush_stdin(). Only supported on Unix-like systems.
+  bool nonblocking_stdin = false;
   /// Set to true to inherit file descriptors from parent process. Default is false. Only supported on Unix-like systems.
   bool inherit_file_descriptors = false;
+  /// Cores the child process is pinned to (Linux only), empty for no pinning
+  std::vector<int> cpu_affinity;
 };
 
 /// Platform independent class for creating processes.
@@ -54,6 +61,8 @@ private:
   };
 
 public:
+  /// read_stdout is called with n == 0 once the output of the process has been read out.
+  /// On Windows, stderr goes into the stdout pipe when only read_stdout is given.
   /// Starts a process with the environment of the calling process.
   Process(const std::vector<string_type> &arguments, const string_type &path = string_type(),
           std::function<void(const char *bytes, size_t n)> read_stdout = nullptr,
@@ -104,6 +113,10 @@ public:
   bool write(const char *bytes, size_t n);
   /// Write to stdin. Convenience function using write(const char *, size_t).
   bool write(const std::string &data);
+  /// Write pieces to stdin in one system call (writev on Unix-like systems).
+  bool write(const std::vector<std::string> &pieces);
+  /// Send data kept from earlier non-blocking writes. Returns false on errors.
+  bool flush_stdin();
   /// Close stdin. If the process takes parameters from stdin, use this to notify that all parameters have been sent.
   void close_stdin() noexcept;
 
@@ -125,6 +138,11 @@ private:
 #endif
   bool open_stdin;
   std::mutex stdin_mutex;
+#ifndef _WIN32
+  bool stdin_nonblocking = false;
+  std::string stdin_pending;
+  bool flush_stdin_locked();
+#endif
 
   Config config;
 
@@ -134,6 +152,8 @@ private:
   id_type open(const string_type &command, const string_type &path, const environment_type *environment = nullptr) noexcept;
 #ifndef _WIN32
   id_type open(const std::function<void()> &function) noexcept;
+  /// Starts arguments[0] directly by posix_spawn, no fork of the calling process. Returns 0 if not supported
+  id_type spawn(const std::vector<string_type> &arguments, const string_type &path, const environment_type *environment) noexcept;
 #endif
   void async_read() noexcept;
   void close_fds() noexcept;
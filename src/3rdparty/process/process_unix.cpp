@@ -5,11 +5,57 @@
 #include <poll.h>
 #include <set>
 #include <signal.h>
+#include <spawn.h>
 #include <stdexcept>
+#include <sys/uio.h>
 #include <unistd.h>
+#ifdef __linux__
+#include <sched.h>
+#include <sys/syscall.h>
+#endif
+
+// posix_spawn is used when children can be given only their standard fds
+// (closefrom action of glibc 2.34, POSIX_SPAWN_CLOEXEC_DEFAULT of macOS)
+#if defined(__GLIBC__) && defined(__GLIBC_PREREQ)
+#if __GLIBC_PREREQ(2, 34)
+#define TPL_POSIX_SPAWN
+#endif
+#elif defined(__APPLE__)
+#define TPL_POSIX_SPAWN
+#endif
+
+extern char **environ;
 
 namespace TinyProcessLib {
 
+namespace {
+/// Close all fds from 3 in a forked child
+void close_inherited_fds() noexcept {
+#if defined(__linux__) && defined(SYS_close_range)
+  if(syscall(SYS_close_range, 3, ~0U, 0) == 0)
+    return;
+#endif
+  int fd_max = static_cast<int>(sysconf(_SC_OPEN_MAX)); // truncation is safe
+  // Based on http://stackoverflow.com/a/899533/3808293
+  for(int fd = 3; fd < fd_max; fd++)
+    close(fd);
+}
+
+#ifdef TPL_POSIX_SPAWN
+int make_pipe(int p[2]) noexcept {
+#ifdef __linux__
+  return pipe2(p, O_CLOEXEC);
+#else
+  if(pipe(p) != 0)
+    return -1;
+  fcntl(p[0], F_SETFD, FD_CLOEXEC);
+  fcntl(p[1], F_SETFD, FD_CLOEXEC);
+  return 0;
+#endif
+}
+#endif
+} // namespace
+
 Process::Data::Data() noexcept : id(-1) {}
 
 Process::Process(const std::function<void()> &function,
@@ -89,15 +135,23 @@ Process::id_type Process::open(const std::function<void()> &function) noexcept {
       close(stderr_p[1]);
     }
 
-    if(!config.inherit_file_descriptors) {
-      int fd_max = static_cast<int>(sysconf(_SC_OPEN_MAX)); // truncation is safe
-      // Based on http://stackoverflow.com/a/899533/3808293
-      // TODO: find a way to optimize, as this is slow on systems with high fd_max
-      for(int fd = 3; fd < fd_max; fd++)
-        close(fd);
-    }
+    if(!config.inherit_file_descriptors)
+      close_inherited_fds();
 
     setpgid(0, 0);
+
+#ifdef __linux__
+    // Pin before exec so all threads created by the child inherit the affinity
+    if(!config.cpu_affinity.empty()) {
+      cpu_set_t cpu_set;
+      CPU_ZERO(&cpu_set);
+      for(auto cpu : config.cpu_affinity) {
+        if(cpu >= 0 && cpu < CPU_SETSIZE)
+          CPU_SET(cpu, &cpu_set);
+      }
+      sched_setaffinity(0, sizeof(cpu_set), &cpu_set);
+    }
+#endif
     //TODO: See here on how to emulate tty for colors: http://stackoverflow.com/questions/1401002/trick-an-application-into-thinking-its-stdin-is-interactive-not-a-pipe
     //TODO: One solution is: echo "command;exit"|script -q /dev/null
 
@@ -126,7 +180,110 @@ Process::id_type Process::open(const std::function<void()> &function) noexcept {
   return pid;
 }
 
+Process::id_type Process::spawn(const std::vector<string_type> &arguments, const string_type &path, const environment_type *environment) noexcept {
+#ifdef TPL_POSIX_SPAWN
+  if(arguments.empty())
+    return -1;
+
+  // all pipe ends are close-on-exec, the dup2 copies are not
+  int stdin_p[2] = {-1, -1}, stdout_p[2] = {-1, -1}, stderr_p[2] = {-1, -1};
+  auto close_pipes = [&] {
+    for(auto fd : {stdin_p[0], stdin_p[1], stdout_p[0], stdout_p[1], stderr_p[0], stderr_p[1]}) {
+      if(fd >= 0)
+        close(fd);
+    }
+  };
+  if((open_stdin && make_pipe(stdin_p) != 0) ||
+     (read_stdout && make_pipe(stdout_p) != 0) ||
+     (read_stderr && make_pipe(stderr_p) != 0)) {
+    close_pipes();
+    return -1;
+  }
+
+  posix_spawn_file_actions_t actions;
+  posix_spawn_file_actions_init(&actions);
+  if(open_stdin)
+    posix_spawn_file_actions_adddup2(&actions, stdin_p[0], 0);
+  if(read_stdout)
+    posix_spawn_file_actions_adddup2(&actions, stdout_p[1], 1);
+  if(read_stderr)
+    posix_spawn_file_actions_adddup2(&actions, stderr_p[1], 2);
+  if(!path.empty())
+    posix_spawn_file_actions_addchdir_np(&actions, path.c_str());
+
+  posix_spawnattr_t attr;
+  posix_spawnattr_init(&attr);
+  short flags = POSIX_SPAWN_SETPGROUP;
+  posix_spawnattr_setpgroup(&attr, 0);
+
+  if(!config.inherit_file_descriptors) {
+#ifdef __APPLE__
+    flags |= POSIX_SPAWN_CLOEXEC_DEFAULT;
+#else
+    posix_spawn_file_actions_addclosefrom_np(&actions, 3);
+#endif
+  }
+  posix_spawnattr_setflags(&attr, flags);
+
+  std::vector<char *> argv_ptrs;
+  argv_ptrs.reserve(arguments.size() + 1);
+  for(auto &argument : arguments)
+    argv_ptrs.emplace_back(const_cast<char *>(argument.c_str()));
+  argv_ptrs.emplace_back(nullptr);
+
+  std::vector<std::string> env_strs;
+  std::vector<char *> env_ptrs;
+  if(environment) {
+    env_strs.reserve(environment->size());
+    for(const auto &e : *environment)
+      env_strs.emplace_back(e.first + '=' + e.second);
+    for(auto &e : env_strs)
+      env_ptrs.emplace_back(const_cast<char *>(e.c_str()));
+    env_ptrs.emplace_back(nullptr);
+  }
+
+  pid_t pid;
+  auto err = posix_spawn(&pid, arguments[0].c_str(), &actions, &attr, argv_ptrs.data(), environment ? env_ptrs.data() : environ);
+  posix_spawn_file_actions_destroy(&actions);
+  posix_spawnattr_destroy(&attr);
+
+  if(err != 0) {
+    close_pipes();
+    return -1;
+  }
+
+  if(open_stdin) {
+    close(stdin_p[0]);
+    stdin_fd = std::unique_ptr<fd_type>(new fd_type(stdin_p[1]));
+  }
+  if(read_stdout) {
+    close(stdout_p[1]);
+    stdout_fd = std::unique_ptr<fd_type>(new fd_type(stdout_p[0]));
+  }
+  if(read_stderr) {
+    close(stderr_p[1]);
+    stderr_fd = std::unique_ptr<fd_type>(new fd_type(stderr_p[0]));
+  }
+
+  closed = false;
+  data.id = pid;
+  return pid;
+#else
+  (void)arguments;
+  (void)path;
+  (void)environment;
+  return 0;
+#endif
+}
+
 Process::id_type Process::open(const std::vector<string_type> &arguments, const string_type &path, const environment_type *environment) noexcept {
+  // the child is pinned between fork and exec, that needs the forking path
+  if(config.cpu_affinity.empty()) {
+    auto pid = spawn(arguments, path, environment);
+    if(pid != 0)
+      return pid;
+  }
+
   return open([&arguments, &path, &environment] {
     if(arguments.empty())
       exit(127);
@@ -185,12 +342,20 @@ Process::id_type Process::open(const std::string &command, const std::string &pa
 }
 
 void Process::async_read() noexcept {
-  if(data.id <= 0 || (!stdout_fd && !stderr_fd))
+  if(data.id <= 0 || (!stdout_fd && !stderr_fd)) {
+    if(read_stdout)
+      read_stdout(nullptr, 0);
     return;
+  }
 
   stdout_stderr_thread = std::thread([this] {
     std::vector<pollfd> pollfds;
     std::bitset<2> fd_is_stdout;
+#ifdef F_SETPIPE_SZ
+    // a failure (e.g. over the user limit) keeps the default capacity
+    if(stdout_fd && config.pipe_size > 0)
+      fcntl(*stdout_fd, F_SETPIPE_SZ, static_cast<int>(config.pipe_size));
+#endif
     if(stdout_fd) {
       fd_is_stdout.set(pollfds.size());
       pollfds.emplace_back();
@@ -204,9 +369,36 @@ void Process::async_read() noexcept {
     }
     auto buffer = std::unique_ptr<char[]>(new char[config.buffer_size]);
     bool any_open = !pollfds.empty();
+
+    // the exit of the process ends reading at once, even if its children still hold the pipes
+    size_t pid_idx = pollfds.size();
+#if defined(__linux__) && defined(SYS_pidfd_open)
+    if(any_open) {
+      auto pid_fd = static_cast<int>(syscall(SYS_pidfd_open, data.id, 0));
+      if(pid_fd >= 0) {
+        pollfds.emplace_back();
+        pollfds.back().fd = pid_fd;
+        pollfds.back().events = POLLIN;
+      }
+    }
+#endif
+
     while(any_open && (poll(pollfds.data(), pollfds.size(), -1) > 0 || errno == EINTR)) {
       any_open = false;
-      for(size_t i = 0; i < pollfds.size(); ++i) {
+      if(pid_idx < pollfds.size() && (pollfds[pid_idx].revents & POLLIN)) {
+        // take what the process has written before exiting
+        for(size_t i = 0; i < pid_idx; ++i) {
+          ssize_t n;
+          while(pollfds[i].fd >= 0 && (n = read(pollfds[i].fd, buffer.get(), config.buffer_size)) > 0) {
+            if(fd_is_stdout[i])
+              read_stdout(buffer.get(), static_cast<size_t>(n));
+            else
+              read_stderr(buffer.get(), static_cast<size_t>(n));
+          }
+        }
+        break;
+      }
+      for(size_t i = 0; i < pid_idx; ++i) {
         if(pollfds[i].fd >= 0) {
           if(pollfds[i].revents & POLLIN) {
             const ssize_t n = read(pollfds[i].fd, buffer.get(), config.buffer_size);
@@ -229,6 +421,11 @@ void Process::async_read() noexcept {
         }
       }
     }
+
+    if(pid_idx < pollfds.size())
+      close(pollfds[pid_idx].fd);
+    if(read_stdout)
+      read_stdout(nullptr, 0);
   });
 }
 
@@ -313,19 +510,78 @@ void Process::close_fds() noexcept {
 }
 
 bool Process::write(const char *bytes, size_t n) {
+  return write(std::vector<std::string>{std::string(bytes, n)});
+}
+
+bool Process::write(const std::vector<std::string> &pieces) {
   if(!open_stdin)
     throw std::invalid_argument("Can't write to an unopened stdin pipe. Please set open_stdin=true when constructing the process.");
 
   std::lock_guard<std::mutex> lock(stdin_mutex);
-  if(stdin_fd) {
-    if(::write(*stdin_fd, bytes, n) >= 0) {
-      return true;
+  if(!stdin_fd)
+    return false;
+
+  if(config.nonblocking_stdin && !stdin_nonblocking)
+    stdin_nonblocking = fcntl(*stdin_fd, F_SETFL, fcntl(*stdin_fd, F_GETFL) | O_NONBLOCK) == 0;
+
+  // nothing may overtake data kept from earlier writes
+  if(!stdin_pending.empty()) {
+    for(auto &piece : pieces)
+      stdin_pending += piece;
+    return flush_stdin_locked();
+  }
+
+  std::vector<iovec> iov;
+  for(auto &piece : pieces) {
+    if(!piece.empty()) {
+      iov.emplace_back();
+      iov.back().iov_base = const_cast<char *>(piece.data());
+      iov.back().iov_len = piece.size();
+    }
+  }
+  if(iov.empty())
+    return true;
+
+  ssize_t n;
+  do {
+    n = writev(*stdin_fd, iov.data(), static_cast<int>(iov.size()));
+  } while(n < 0 && errno == EINTR);
+  if(n < 0 && errno != EAGAIN && errno != EWOULDBLOCK)
+    return false;
+
+  // keep what has not been taken
+  auto skip = n > 0 ? static_cast<size_t>(n) : 0;
+  for(auto &piece : pieces) {
+    if(skip >= piece.size()) {
+      skip -= piece.size();
+      continue;
     }
+    stdin_pending.append(piece, skip, std::string::npos);
+    skip = 0;
+  }
+  return stdin_pending.empty() || flush_stdin_locked();
+}
+
+bool Process::flush_stdin() {
+  std::lock_guard<std::mutex> lock(stdin_mutex);
+  return !stdin_fd || flush_stdin_locked();
+}
+
+bool Process::flush_stdin_locked() {
+  size_t sent = 0;
+  while(sent < stdin_pending.size()) {
+    auto n = ::write(*stdin_fd, stdin_pending.data() + sent, stdin_pending.size() - sent);
+    if(n > 0)
+      sent += static_cast<size_t>(n);
+    else if(n < 0 && errno == EINTR)
+      continue;
     else {
-      return false;
+      stdin_pending.erase(0, sent);
+      return n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK);
     }
   }
-  return false;
+  stdin_pending.clear();
+  return true;
 }
 
 void Process::close_stdin() noexcept {
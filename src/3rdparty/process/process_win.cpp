@@ -97,7 +97,7 @@ Process::id_type Process::open(const string_type &command, const string_type &pa
   startup_info.cb = sizeof(STARTUPINFO);
   startup_info.hStdInput = stdin_rd_p;
   startup_info.hStdOutput = stdout_wr_p;
-  startup_info.hStdError = stderr_wr_p;
+  startup_info.hStdError = stderr_fd || !stdout_fd ? stderr_wr_p : stdout_wr_p;
   if(stdin_fd || stdout_fd || stderr_fd)
     startup_info.dwFlags |= STARTF_USESTDHANDLES;
 
@@ -151,8 +151,12 @@ Process::id_type Process::open(const string_type &command, const string_type &pa
 }
 
 void Process::async_read() noexcept {
-  if(data.id == 0)
-    return;
+  if(data.id == 0 || !stdout_fd) {
+    if(read_stdout)
+      read_stdout(nullptr, 0);
+    if(data.id == 0)
+      return;
+  }
 
   if(stdout_fd) {
     stdout_thread = std::thread([this]() {
@@ -164,6 +168,7 @@ void Process::async_read() noexcept {
           break;
         read_stdout(buffer.get(), static_cast<size_t>(n));
       }
+      read_stdout(nullptr, 0);
     });
   }
   if(stderr_fd) {
@@ -241,6 +246,17 @@ void Process::close_fds() noexcept {
   }
 }
 
+bool Process::write(const std::vector<std::string> &pieces) {
+  std::string data;
+  for(auto &piece : pieces)
+    data += piece;
+  return write(data.c_str(), data.size());
+}
+
+bool Process::flush_stdin() {
+  return true;
+}
+
 bool Process::write(const char *bytes, size_t n) {
   if(!open_stdin)
     throw std::invalid_argument("Can't write to an unopened stdin pipe. Please set open_stdin=true when constructing the process.");
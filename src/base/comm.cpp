@@ -24,7 +24,6 @@
 
 
 #include <cstdarg>
-#include <regex>
 #include <fstream>
 #include <iomanip> // for setfill, setw
 
@@ -68,14 +67,14 @@ namespace banksia {
     bool profileMode = false;
 
     extern const char* pieceTypeName;
-    extern const char* reasonStrings[12];
+    extern const char* reasonStrings[13];
     extern const char* resultStrings[5];
     extern const char* sideStrings[4];
     extern const char* shortSideStrings[4];
 
     const char* pieceTypeName = ".kqrbnp";
     const char* reasonStrings[] = {
-        "*", "mate", "stalemate", "repetition", "resign", "fifty moves", "insufficient material", "illegal move", "timeout", "adjudication", "crash", nullptr
+        "*", "mate", "stalemate", "repetition", "resign", "fifty moves", "insufficient material", "illegal move", "timeout", "adjudication", "crash", "score adjudication", nullptr
     };
     
     // noresult, win, draw, loss
@@ -231,13 +230,6 @@ namespace banksia {
         }
         return subject;
     }
-    std::vector<std::string> splitString(const std::string& string, const std::string& regexString)
-    {
-        std::regex re(regexString);
-        std::sregex_token_iterator first{ string.begin(), string.end(), re }, last;
-        return { first, last };
-    }
-    
     std::vector<std::string> splitString(const std::string &s, char delim)
     {
         std::vector<std::string> elems;
@@ -118,6 +118,8 @@ namespace banksia {
     const int B = 0;
     const int W = 1;
     
+    const int MateScore = 30000;
+    
     enum class Side {
         black = 0, white = 1, none = 2
     };
@@ -141,7 +143,8 @@ namespace banksia {
         illegalmove,
         timeout,
         adjudication,
-        crash
+        crash,
+        scoreadjudication
     };
     
     enum class MoveNotation {
@@ -164,7 +167,7 @@ namespace banksia {
     extern bool banksiaVerbose;
     extern bool profileMode;
     extern const char* pieceTypeName;
-    extern const char* reasonStrings[12];
+    extern const char* reasonStrings[13];
     
     std::string getVersion();
     std::string getAppName();
@@ -194,7 +197,6 @@ namespace banksia {
     int getNumberOfCores();
     size_t getMemorySize();
     
-    std::vector<std::string> splitString(const std::string& string, const std::string& regexString);
     std::vector<std::string> splitString(const std::string &s, char delim);
     
     std::string resultType2String(ResultType type);
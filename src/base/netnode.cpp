@@ -0,0 +1,457 @@
+/*
+ This file is part of Banksia.
+ 
+ Copyright (c) 2019 Nguyen Hong Pham
+ 
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+ 
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+ 
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+ */
+
+
+
+#include <thread>
+#include <cstring>
+
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#ifdef _MSC_VER
+#pragma comment(lib, "Ws2_32.lib")
+#endif
+#else
+#include <sys/socket.h>
+#include <poll.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#endif
+
+#include "netnode.h"
+
+using namespace banksia;
+
+const size_t NetNode::maxLineSize;
+
+#ifdef _WIN32
+typedef SOCKET socket_t;
+#define SHUT_RDWR SD_BOTH
+static void closeSocket(socket_t s) { closesocket(s); }
+static bool isValidSocket(socket_t s) { return s != INVALID_SOCKET; }
+static void setNonBlocking(socket_t s, bool on) { u_long mode = on ? 1 : 0; ioctlsocket(s, FIONBIO, &mode); }
+static bool isConnectInProgress() { return WSAGetLastError() == WSAEWOULDBLOCK; }
+#else
+typedef int socket_t;
+static void closeSocket(socket_t s) { close(s); }
+static bool isValidSocket(socket_t s) { return s >= 0; }
+static void setNonBlocking(socket_t s, bool on) {
+    auto flags = fcntl(s, F_GETFL, 0);
+    fcntl(s, F_SETFL, on ? (flags | O_NONBLOCK) : (flags & ~O_NONBLOCK));
+}
+static bool isConnectInProgress() { return errno == EINPROGRESS; }
+#endif
+
+#ifdef MSG_NOSIGNAL
+#define SEND_FLAGS MSG_NOSIGNAL
+#else
+#define SEND_FLAGS 0
+#endif
+
+// network threads check for stopping at least that often
+static const int waitSliceMs = 200;
+// a peer which doesn't read for that long is dropped
+static const int sendTimeoutSec = 10;
+static const int connectTimeoutSec = 10;
+
+static void initNetwork()
+{
+#ifdef _WIN32
+    static std::once_flag flag;
+    std::call_once(flag, []() {
+        WSADATA wsaData;
+        WSAStartup(MAKEWORD(2, 2), &wsaData);
+    });
+#endif
+}
+
+// true if the socket becomes readable (or writable) within the period
+static bool waitSocket(socket_t s, bool forWriting, int ms)
+{
+#ifdef _WIN32
+    WSAPOLLFD fd;
+    fd.fd = s;
+    fd.events = forWriting ? POLLOUT : POLLIN;
+    fd.revents = 0;
+    return WSAPoll(&fd, 1, ms) > 0;
+#else
+    pollfd fd;
+    fd.fd = s;
+    fd.events = forWriting ? POLLOUT : POLLIN;
+    fd.revents = 0;
+    return poll(&fd, 1, ms) > 0;
+#endif
+}
+
+NetNode::~NetNode()
+{
+    close();
+}
+
+bool NetNode::isValid() const
+{
+    return true;
+}
+
+bool NetNode::isLoopbackAddress(const std::string& address)
+{
+    return address == "localhost" || address == "::1" || address.compare(0, 4, "127.") == 0;
+}
+
+bool NetNode::listen(const std::string& address, int port)
+{
+    initNetwork();
+    
+    addrinfo hints, *res = nullptr;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    hints.ai_flags = AI_PASSIVE;
+    
+    if (getaddrinfo(address.empty() ? nullptr : address.c_str(), std::to_string(port).c_str(), &hints, &res) != 0) {
+        return false;
+    }
+    
+    auto sock = socket_t(-1);
+    for(auto p = res; p; p = p->ai_next) {
+        sock = socket(p->ai_family, p->ai_socktype, p->ai_protocol);
+        if (!isValidSocket(sock)) {
+            continue;
+        }
+        
+        int yes = 1;
+        setsockopt(sock, SOL_SOCKET, SO_REUSEADDR, (const char*)&yes, sizeof(yes));
+        
+        if (bind(sock, p->ai_addr, (int)p->ai_addrlen) == 0 && ::listen(sock, 16) == 0) {
+            break;
+        }
+        closeSocket(sock);
+        sock = socket_t(-1);
+    }
+    freeaddrinfo(res);
+    
+    if (!isValidSocket(sock)) {
+        return false;
+    }
+    
+    listenSock = static_cast<i64>(sock);
+    
+    acceptThread = std::thread([=]() {
+        while (!stopping) {
+            if (!waitSocket(sock, false, waitSliceMs)) {
+                continue;
+            }
+            auto s = accept(sock, nullptr, nullptr);
+            if (isValidSocket(s)) {
+                addConnection(static_cast<i64>(s));
+            }
+        }
+    });
+    return true;
+}
+
+void NetNode::connectAsync(const std::string& host, int port)
+{
+    initNetwork();
+    
+    // one attempt at a time, the previous one has reported its result
+    if (connectThread.joinable()) {
+        connectThread.join();
+    }
+    
+    connectThread = std::thread([=]() {
+        addrinfo hints, *res = nullptr;
+        memset(&hints, 0, sizeof(hints));
+        hints.ai_family = AF_UNSPEC;
+        hints.ai_socktype = SOCK_STREAM;
+        
+        if (getaddrinfo(host.c_str(), std::to_string(port).c_str(), &hints, &res) == 0) {
+            for(auto p = res; p && !stopping; p = p->ai_next) {
+                auto s = socket(p->ai_family, p->ai_socktype, p->ai_protocol);
+                if (!isValidSocket(s)) {
+                    continue;
+                }
+                
+                // waits in slices to stay responsive to close()
+                setNonBlocking(s, true);
+                auto ok = connect(s, p->ai_addr, (int)p->ai_addrlen) == 0;
+                if (!ok && isConnectInProgress()) {
+                    for(int ms = 0; ms < connectTimeoutSec * 1000 && !stopping; ms += waitSliceMs) {
+                        if (waitSocket(s, true, waitSliceMs)) {
+                            int err = 0;
+                            socklen_t len = sizeof(err);
+                            ok = getsockopt(s, SOL_SOCKET, SO_ERROR, (char*)&err, &len) == 0 && err == 0;
+                            break;
+                        }
+                    }
+                }
+                
+                if (ok && !stopping) {
+                    setNonBlocking(s, false);
+                    freeaddrinfo(res);
+                    addConnection(static_cast<i64>(s));
+                    return;
+                }
+                closeSocket(s);
+            }
+            freeaddrinfo(res);
+        }
+        pushEvent(-1, "connectfailed");
+    });
+}
+
+int NetNode::addConnection(i64 sock)
+{
+    auto s = static_cast<socket_t>(sock);
+    if (stopping) {
+        closeSocket(s);
+        return -1;
+    }
+    
+    int yes = 1;
+    setsockopt(s, IPPROTO_TCP, TCP_NODELAY, (const char*)&yes, sizeof(yes));
+    
+#ifdef _WIN32
+    DWORD timeout = sendTimeoutSec * 1000;
+#else
+    timeval timeout;
+    timeout.tv_sec = sendTimeoutSec;
+    timeout.tv_usec = 0;
+#endif
+    setsockopt(s, SOL_SOCKET, SO_SNDTIMEO, (const char*)&timeout, sizeof(timeout));
+    
+    auto conn = std::make_shared<Connection>();
+    conn->sock = sock;
+    
+    joinFinishedThreads();
+    
+    std::lock_guard<std::mutex> dolock(threadMutex);
+    int connId;
+    {
+        std::lock_guard<std::mutex> dolock(connMutex);
+        connId = nextConnId++;
+        connMap[connId] = conn;
+    }
+    
+    // before any message of the connection
+    pushEvent(connId, "connected");
+    
+    readThreadMap[connId] = std::thread([=]() {
+        readLoop(connId, conn);
+    });
+    return connId;
+}
+
+void NetNode::joinFinishedThreads()
+{
+    std::vector<std::thread> threads;
+    {
+        std::lock_guard<std::mutex> dolock(threadMutex);
+        for(auto && connId : finishedReadList) {
+            auto it = readThreadMap.find(connId);
+            if (it != readThreadMap.end()) {
+                threads.push_back(std::move(it->second));
+                readThreadMap.erase(it);
+            }
+        }
+        finishedReadList.clear();
+    }
+    
+    for(auto && t : threads) {
+        t.join();
+    }
+}
+
+void NetNode::readLoop(int connId, std::shared_ptr<Connection> conn)
+{
+    auto s = static_cast<socket_t>(conn->sock);
+    std::string buf;
+    char bytes[4096];
+    
+    while (true) {
+        auto n = recv(s, bytes, sizeof(bytes), 0);
+        if (n <= 0) {
+            break;
+        }
+        buf.append(bytes, n);
+        
+        size_t k = 0;
+        for(size_t p; (p = buf.find('\n', k)) != std::string::npos; k = p + 1) {
+            Json::Value data;
+            auto line = buf.substr(k, p - k);
+            if (!line.empty() && JsonSavable::loadFromJsonString(line, data, false) && data.isObject()) {
+                pushMessage(connId, data);
+            }
+        }
+        buf.erase(0, k);
+        
+        if (buf.size() > maxLineSize) {
+            std::cout << "Warning: dropped connection " << connId << ", message over " << maxLineSize / (1024 * 1024) << " MB" << std::endl;
+            break;
+        }
+    }
+    
+    {
+        std::lock_guard<std::mutex> dolock(connMutex);
+        connMap.erase(connId);
+    }
+    {
+        std::lock_guard<std::mutex> dolock(conn->sendMutex);
+        closeSocket(s);
+        conn->sock = -1;
+    }
+    
+    if (!stopping) {
+        pushEvent(connId, "disconnected");
+    }
+    
+    std::lock_guard<std::mutex> dolock(threadMutex);
+    finishedReadList.push_back(connId);
+}
+
+bool NetNode::send(int connId, const Json::Value& data)
+{
+    Json::StreamWriterBuilder builder;
+    builder["indentation"] = "";
+    auto str = Json::writeString(builder, data) + "\n";
+    
+    std::shared_ptr<Connection> conn;
+    {
+        std::lock_guard<std::mutex> dolock(connMutex);
+        auto it = connMap.find(connId);
+        if (it == connMap.end()) {
+            return false;
+        }
+        conn = it->second;
+    }
+    
+    // other connections are not blocked by a slow peer
+    std::lock_guard<std::mutex> dolock(conn->sendMutex);
+    if (conn->sock < 0) {
+        return false;
+    }
+    
+    auto s = static_cast<socket_t>(conn->sock);
+    for(size_t k = 0; k < str.size(); ) {
+        auto n = ::send(s, str.c_str() + k, (int)(str.size() - k), SEND_FLAGS);
+        if (n <= 0) {
+            // the reader will clean up
+            ::shutdown(s, SHUT_RDWR);
+            return false;
+        }
+        k += n;
+    }
+    return true;
+}
+
+void NetNode::disconnect(int connId)
+{
+    std::lock_guard<std::mutex> dolock(connMutex);
+    auto it = connMap.find(connId);
+    if (it != connMap.end()) {
+        ::shutdown(static_cast<socket_t>(it->second->sock), SHUT_RDWR);
+    }
+}
+
+bool NetNode::isConnected(int connId) const
+{
+    std::lock_guard<std::mutex> dolock(connMutex);
+    return connMap.find(connId) != connMap.end();
+}
+
+void NetNode::close()
+{
+    stopping = true;
+    
+    // no more connections after these threads
+    if (acceptThread.joinable()) {
+        acceptThread.join();
+    }
+    if (listenSock >= 0) {
+        closeSocket(static_cast<socket_t>(listenSock));
+        listenSock = -1;
+    }
+    
+    if (connectThread.joinable()) {
+        connectThread.join();
+    }
+    
+    std::map<int, std::thread> threads;
+    {
+        std::lock_guard<std::mutex> dolock(connMutex);
+        for(auto && p : connMap) {
+            ::shutdown(static_cast<socket_t>(p.second->sock), SHUT_RDWR);
+        }
+    }
+    {
+        std::lock_guard<std::mutex> dolock(threadMutex);
+        threads.swap(readThreadMap);
+        finishedReadList.clear();
+    }
+    for(auto && p : threads) {
+        p.second.join();
+    }
+}
+
+void NetNode::pushEvent(int connId, const std::string& type)
+{
+    Json::Value data;
+    data["type"] = type;
+    pushMessage(connId, data, true);
+}
+
+void NetNode::pushMessage(int connId, const Json::Value& data, bool event)
+{
+    NetMessage msg;
+    msg.connId = connId;
+    msg.data = data;
+    msg.event = event;
+    
+    std::lock_guard<std::mutex> dolock(inboxMutex);
+    inbox.push_back(msg);
+}
+
+std::string NetNode::getHostName()
+{
+    initNetwork();
+    char name[256];
+    if (gethostname(name, sizeof(name)) == 0) {
+        name[sizeof(name) - 1] = 0;
+        return name;
+    }
+    return "localhost";
+}
+
+std::vector<NetMessage> NetNode::takeMessages()
+{
+    std::vector<NetMessage> vec;
+    std::lock_guard<std::mutex> dolock(inboxMutex);
+    vec.swap(inbox);
+    return vec;
+}
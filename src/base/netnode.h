@@ -0,0 +1,112 @@
+/*
+ This file is part of Banksia.
+ 
+ Copyright (c) 2019 Nguyen Hong Pham
+ 
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+ 
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+ 
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+ */
+
+
+
+#ifndef netnode_h
+#define netnode_h
+
+#include <map>
+#include <memory>
+#include <thread>
+#include <atomic>
+
+#include "comm.h"
+
+namespace banksia {
+    
+    // A message from a connection. Network events come as messages too,
+    // with types "connected", "connectfailed" and "disconnected"
+    class NetMessage {
+    public:
+        int connId = -1;
+        Json::Value data;
+        bool event = false; // created by the node itself, never by peers
+    };
+    
+    // Exchanges JSON objects, one per line, over TCP connections. Network threads
+    // only queue received messages, users process them by calling takeMessages
+    class NetNode : public Obj
+    {
+    public:
+        virtual ~NetNode();
+        
+        virtual const char* className() const override { return "NetNode"; }
+        virtual bool isValid() const override;
+        
+        // server side, accept connections on a given address in background
+        bool listen(const std::string& address, int port);
+        
+        // client side, the result comes later as a message
+        void connectAsync(const std::string& host, int port);
+        
+        bool send(int connId, const Json::Value& data);
+        void disconnect(int connId);
+        bool isConnected(int connId) const;
+        
+        // stops all connections and waits for the network threads
+        void close();
+        
+        std::vector<NetMessage> takeMessages();
+        
+        static std::string getHostName();
+        static bool isLoopbackAddress(const std::string& address);
+        
+    private:
+        // a socket is closed only by its reader and only under sendMutex,
+        // so senders never write to a reused socket
+        class Connection {
+        public:
+            i64 sock = -1;
+            std::mutex sendMutex;
+        };
+        
+        int addConnection(i64 sock);
+        void readLoop(int connId, std::shared_ptr<Connection> conn);
+        void joinFinishedThreads();
+        void pushEvent(int connId, const std::string& type);
+        void pushMessage(int connId, const Json::Value& data, bool event = false);
+        
+        // longer lines are not from Banksia, their peers are dropped
+        static const size_t maxLineSize = 8 * 1024 * 1024;
+        
+        mutable std::mutex connMutex;
+        std::map<int, std::shared_ptr<Connection>> connMap;
+        int nextConnId = 1;
+        i64 listenSock = -1;
+        
+        std::mutex threadMutex;
+        std::thread acceptThread, connectThread;
+        std::map<int, std::thread> readThreadMap;
+        std::vector<int> finishedReadList;
+        
+        std::mutex inboxMutex;
+        std::vector<NetMessage> inbox;
+        
+        std::atomic<bool> stopping { false };
+    };
+    
+} // namespace banksia
+
+#endif /* netnode_h */
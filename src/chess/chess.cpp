@@ -270,6 +270,7 @@ void ChessBoard::setFen(const std::string& fen) {
     
     quietCnt = 0;
     hashKey = initHashKey();
+    initMaterial();
 }
 
 std::string ChessBoard::getFen(int halfCount, int fullMoveCount) const {
@@ -885,6 +886,7 @@ void ChessBoard::make(const MoveFull& move, Hist& hist) {
                     hashKey ^= xorHashKey(move.dest);
                     pieces[move.dest].type = move.promotion;
                     hashKey ^= xorHashKey(move.dest);
+                    materialKey += materialBit(pieces[move.dest]) - materialBit(p);
                     quietCnt = 0;
                 }
             }
@@ -896,6 +898,8 @@ void ChessBoard::make(const MoveFull& move, Hist& hist) {
     
     if (!hist.cap.isEmpty()) {
         quietCnt = 0;
+        pieceCount--;
+        materialKey -= materialBit(hist.cap);
     }
     
     if (hist.castleRights[W] != castleRights[W]) {
@@ -957,7 +961,14 @@ void ChessBoard::takeBack(const Hist& hist) {
     }
     
     if (hist.move.promotion != PieceType::empty) {
-        setPiece(hist.move.from, Piece(PieceType::pawn, hist.move.dest < 8 ? Side::white : Side::black));
+        auto pawn = Piece(PieceType::pawn, hist.move.dest < 8 ? Side::white : Side::black);
+        setPiece(hist.move.from, pawn);
+        materialKey += materialBit(pawn) - materialBit(movep);
+    }
+    
+    if (!hist.cap.isEmpty()) {
+        pieceCount++;
+        materialKey += materialBit(hist.cap);
     }
     
     status = hist.status;
@@ -1436,6 +1447,18 @@ int ChessBoard::toPieceCount(int* pieceCnt) const
     return totalCnt;
 }
 
+void ChessBoard::initMaterial()
+{
+    pieceCount = 0;
+    materialKey = 0;
+    for(auto && piece : pieces) {
+        if (!piece.isEmpty()) {
+            pieceCount++;
+            materialKey += materialBit(piece);
+        }
+    }
+}
+
 struct SyzygyPos
 {
     uint64_t white;
@@ -1453,6 +1476,62 @@ struct SyzygyPos
     uint16_t move;
 };
 
+/////////////////////////////////////////////////////////////////////
+// Tablebase probe results, shared by all boards (games) of all threads.
+// Each position has up to two entries: its WDL value and its DTZ.
+// Neither depends on the 50-move counter: the counter only splits wins
+// and losses into two ranges, up to 100 - DTZ and above, which
+// probeSyzygy works out from the cached DTZ.
+const int SyzygyProbeCache::stripeCnt;
+const size_t SyzygyProbeCache::maxStripeSize;
+SyzygyProbeCache::Stripe SyzygyProbeCache::stripes[SyzygyProbeCache::stripeCnt];
+std::atomic<i64> SyzygyProbeCache::hitCnt(0), SyzygyProbeCache::missCnt(0);
+
+u64 SyzygyProbeCache::toCacheKey(u64 key, bool dtz)
+{
+    return dtz ? key ^ 0x9E3779B97F4A7C15ULL : key;
+}
+
+bool SyzygyProbeCache::get(u64 key, bool dtz, unsigned& value)
+{
+    auto k = toCacheKey(key, dtz);
+    auto& stripe = stripes[k % stripeCnt];
+    std::lock_guard<std::mutex> dolock(stripe.mutex);
+    auto it = stripe.map.find(k);
+    if (it == stripe.map.end()) {
+        return false;
+    }
+    value = it->second;
+    return true;
+}
+
+void SyzygyProbeCache::put(u64 key, bool dtz, unsigned value)
+{
+    auto k = toCacheKey(key, dtz);
+    auto& stripe = stripes[k % stripeCnt];
+    std::lock_guard<std::mutex> dolock(stripe.mutex);
+    if (stripe.map.size() >= maxStripeSize) {
+        stripe.map.clear();
+    }
+    stripe.map[k] = static_cast<u8>(std::min(value, 255u));
+}
+
+void SyzygyProbeCache::countLookup(bool hit)
+{
+    if (hit) hitCnt++; else missCnt++;
+}
+
+std::string SyzygyProbeCache::toString()
+{
+    auto hits = hitCnt.load(), misses = missCnt.load();
+    std::ostringstream stringStream;
+    stringStream << "Tablebase probe cache: hits " << hits << ", misses " << misses;
+    if (hits + misses) {
+        stringStream << " (" << std::fixed << std::setprecision(1) << 100.0 * hits / (hits + misses) << "% hit)";
+    }
+    return stringStream.str();
+}
+
 Result ChessBoard::probeSyzygy(int maxPieces, bool& tberror) const
 {
     tberror = false;
@@ -1461,88 +1540,114 @@ Result ChessBoard::probeSyzygy(int maxPieces, bool& tberror) const
         return result;
     }
     
-    auto total = toPieceCount(nullptr);
-    if (total > maxPieces || total > Tablebase::SyzygyTablebase::TB_LARGEST) {
+    if (pieceCount > maxPieces || pieceCount > Tablebase::SyzygyTablebase::TB_LARGEST) {
         return result;
     }
     
-    SyzygyPos pos;
-    memset(&pos, 0, sizeof(pos));
-    
-    uint64_t bm[2] = { 0, 0 };
+    // positions with castling rights are not in tablebases
+    if (castleRights[0] + castleRights[1]) {
+        return result;
+    }
     
-    for(int i = 0; i < 64; i++) {
-        auto piece = getPiece(i);
-        if (piece.isEmpty()) continue;
-        auto sd = static_cast<int>(piece.side);
+    SyzygyPos pos;
+    auto posReady = false;
+    auto setupPos = [&]() {
+        if (posReady) return;
+        posReady = true;
+        memset(&pos, 0, sizeof(pos));
         
-        uint64_t b = 1ULL << ((7 - (i >> 3)) * 8 + (i & 0x7));
-        bm[sd] |= b;
+        uint64_t bm[2] = { 0, 0 };
         
-        switch (piece.type) {
-            case PieceType::king:
-                pos.kings |= b;
-                break;
-            case PieceType::queen:
-                pos.queens |= b;
-                break;
-            case PieceType::rook:
-                pos.rooks |= b;
-                break;
-            case PieceType::bishop:
-                pos.bishops |= b;
-                break;
-            case PieceType::knight:
-                pos.knights |= b;
-                break;
-            case PieceType::pawn:
-                pos.pawns |= b;
-                break;
-                
-            default:
-                break;
+        for(int i = 0; i < 64; i++) {
+            auto piece = getPiece(i);
+            if (piece.isEmpty()) continue;
+            auto sd = static_cast<int>(piece.side);
+            
+            uint64_t b = 1ULL << ((7 - (i >> 3)) * 8 + (i & 0x7));
+            bm[sd] |= b;
+            
+            switch (piece.type) {
+                case PieceType::king:
+                    pos.kings |= b;
+                    break;
+                case PieceType::queen:
+                    pos.queens |= b;
+                    break;
+                case PieceType::rook:
+                    pos.rooks |= b;
+                    break;
+                case PieceType::bishop:
+                    pos.bishops |= b;
+                    break;
+                case PieceType::knight:
+                    pos.knights |= b;
+                    break;
+                case PieceType::pawn:
+                    pos.pawns |= b;
+                    break;
+                    
+                default:
+                    break;
+            }
         }
-    }
-    
-    pos.white = bm[W];
-    pos.black = bm[B];
-    pos.turn = side == Side::white ? 1 : 0;
-    
-    if (castleRights[0] + castleRights[1]) {
-        if (castleRights[B] & CastleRight_short) {
-            pos.castling |= TB_CASTLING_k;
+        
+        pos.white = bm[W];
+        pos.black = bm[B];
+        pos.turn = side == Side::white ? 1 : 0;
+        
+        if (enpassant > 0) {
+            pos.ep = (7 - (enpassant >> 3)) * 8 + (enpassant & 0x7);
         }
-        if (castleRights[B] & CastleRight_long) {
-            pos.castling |= TB_CASTLING_q;
+        
+        pos.rule50 = quietCnt;
+    };
+    
+    // WDL tables are much cheaper than DTZ ones (no root move generation).
+    // They are exact when the 50-move counter is zero. Draws (including
+    // cursed wins and blessed losses) stay draws when the counter is
+    // non-zero. Only wins and losses may then need DTZ to check the counter
+    unsigned wdl;
+    auto hit = SyzygyProbeCache::get(hashKey, false, wdl);
+    if (!hit) {
+        setupPos();
+        wdl = Tablebase::SyzygyTablebase::tb_probe_wdl(pos.white, pos.black, pos.kings,
+                                                       pos.queens, pos.rooks, pos.bishops, pos.knights, pos.pawns,
+                                                       0, 0, pos.ep, pos.turn);
+        if (wdl == TB_RESULT_FAILED) {
+            SyzygyProbeCache::countLookup(false);
+            tberror = true;
+            return result;
         }
-        if (castleRights[W] & CastleRight_short) {
-            pos.castling |= TB_CASTLING_K;
+        SyzygyProbeCache::put(hashKey, false, wdl);
+    }
+    
+    if (quietCnt && (wdl == TB_WIN || wdl == TB_LOSS)) {
+        // The root DTZ is the position's own, whatever the counter, and
+        // the win (loss) holds as long as DTZ + counter <= 100
+        unsigned dtz;
+        if (!SyzygyProbeCache::get(hashKey, true, dtz)) {
+            hit = false;
+            setupPos();
+            unsigned results[TB_MAX_MOVES];
+            unsigned res = Tablebase::SyzygyTablebase::tb_probe_root(pos.white, pos.black, pos.kings,
+                                                                     pos.queens, pos.rooks, pos.bishops, pos.knights, pos.pawns,
+                                                                     pos.rule50, 0, pos.ep, pos.turn, results);
+            if (res == TB_RESULT_FAILED)
+            {
+                SyzygyProbeCache::countLookup(false);
+                tberror = true;
+                return result;
+            }
+            
+            dtz = TB_GET_DTZ(res);
+            SyzygyProbeCache::put(hashKey, true, dtz);
         }
-        if (castleRights[W] & CastleRight_long) {
-            pos.castling |= TB_CASTLING_Q;
+        
+        if (dtz + quietCnt > 100) {
+            wdl = wdl == TB_WIN ? TB_CURSED_WIN : TB_BLESSED_LOSS;
         }
     }
-    
-    if (enpassant > 0) {
-        pos.ep = (7 - (enpassant >> 3)) * 8 + (enpassant & 0x7);
-    }
-    
-    pos.rule50 = quietCnt;
-    
-    unsigned results[TB_MAX_MOVES];
-    unsigned res = Tablebase::SyzygyTablebase::tb_probe_root(pos.white, pos.black, pos.kings,
-                                            pos.queens, pos.rooks, pos.bishops, pos.knights, pos.pawns,
-                                            pos.rule50, pos.castling, pos.ep, pos.turn, results);
-    if (res == TB_RESULT_FAILED)
-    {
-//        printOut();
-//        std::cerr << "Error: unable to probe tablebase; position invalid, illegal or not in tablebase" << std::endl;
-        tberror = true;
-        return result;
-    }
-    
-    // (3) Output:
-    unsigned wdl = TB_GET_WDL(res);
+    SyzygyProbeCache::countLookup(hit);
     
     static const ResultType typeArray[] = {
         ResultType::loss,
@@ -1550,7 +1655,7 @@ Result ChessBoard::probeSyzygy(int maxPieces, bool& tberror) const
         ResultType::win
     };
     
-    result.result = typeArray[pos.turn? wdl: 4 - wdl];
+    result.result = typeArray[side == Side::white ? wdl : 4 - wdl];
     result.reason = ReasonType::adjudication;
     return result;
 }
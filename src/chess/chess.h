@@ -27,12 +27,39 @@
 
 #include <stdio.h>
 
+#include <atomic>
+#include <unordered_map>
+
 #include "../base/base.h"
 
 namespace banksia {
     
     extern const char* originalFen;
     
+    class SyzygyProbeCache {
+    public:
+        static bool get(u64 key, bool dtz, unsigned& value);
+        static void put(u64 key, bool dtz, unsigned value);
+        static void countLookup(bool hit);
+        
+        static i64 getHitCnt() { return hitCnt; }
+        static i64 getMissCnt() { return missCnt; }
+        static std::string toString();
+        
+    private:
+        static u64 toCacheKey(u64 key, bool dtz);
+        
+        static const int stripeCnt = 64;
+        static const size_t maxStripeSize = 16 * 1024;
+        
+        struct Stripe {
+            std::mutex mutex;
+            std::unordered_map<u64, u8> map;
+        };
+        static Stripe stripes[stripeCnt];
+        static std::atomic<i64> hitCnt, missCnt;
+    };
+    
     class ChessBoard : public BoardCore {
         
         const int CastleRight_long  = (1<<0);
@@ -45,6 +72,10 @@ namespace banksia {
         int enpassant;
         int8_t castleRights[2];
         
+        // material, updated incrementally by make/takeBack
+        int pieceCount = 0;
+        u64 materialKey = 0;
+        
     public:
         ChessBoard();
         virtual ~ChessBoard();
@@ -87,6 +118,9 @@ namespace banksia {
         std::vector<std::string> commentEcoString();
         Result probeSyzygy(int maxPieces, bool& tberror) const;
         
+        int getPieceCount() const { return pieceCount; }
+        u64 getMaterialKey() const { return materialKey; }
+        
     private:
         void checkEnpassant();
         
@@ -100,6 +134,11 @@ namespace banksia {
         u64 hashKeyEnpassant(int enpassant) const;
         
         int toPieceCount(int* pieceCnt) const;
+        void initMaterial();
+        
+        static u64 materialBit(Piece piece) {
+            return 1ULL << ((static_cast<int>(piece.side) * 7 + static_cast<int>(piece.type)) * 4);
+        }
         
     private:
         bool createStringForLastMove(const std::vector<MoveFull>& moveList);
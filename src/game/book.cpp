@@ -503,14 +503,14 @@ Json::Value BookMng::saveToJson() const
     return obj;
 }
 
-bool BookMng::getRandomBook(int pairId, std::string& fenString, std::vector<Move>& moves)
+bool BookMng::getRandomBook(int gameIdx, int pairId, std::string& fenString, std::vector<Move>& moves)
 {
     fenString = "";
     moves.clear();
     
     queryCnt++;
-    if (queryCnt == 1) {
-        std::srand(seed >= 0 ? seed : static_cast<unsigned int>(std::time(nullptr)));
+    if (queryCnt == 1 && seed < 0) {
+        std::srand(static_cast<unsigned int>(std::time(nullptr)));
     }
 
     if (bookSelectType == BookSelectType::allone) {
@@ -528,20 +528,46 @@ bool BookMng::getRandomBook(int pairId, std::string& fenString, std::vector<Move
         return false;
     }
     
-    if (queryCnt == 1 ||
-        bookSelectType == BookSelectType::allnew ||
-        (bookSelectType == BookSelectType::samepair && pairId != lastPairIdx)
-        ) {
+    // Openings are picked when games start, not in list order, thus a pair's
+    // opening is cached by its pairId and, with a seed, the random generator is
+    // re-seeded by the game (or pair) so results don't depend on starting order
+    if (bookSelectType == BookSelectType::samepair) {
+        auto it = pairBookMap.find(pairId);
+        if (it != pairBookMap.end()) {
+            fenString = it->second.first;
+            moves = it->second.second;
+            return true;
+        }
+    }
+    
+    if (queryCnt == 1 || bookSelectType != BookSelectType::allone) {
+        if (seed >= 0) {
+            auto key = bookSelectType == BookSelectType::samepair ? pairId : gameIdx;
+            std::srand(static_cast<unsigned int>(seed) ^ static_cast<unsigned int>(key * 2654435761u));
+        }
         theFenString = "";
         theMoves.clear();
         auto k = size_t(rand()) % bookList.size();
         bookList.at(k)->getRandomBook(theFenString, theMoves);
+        
+        if (bookSelectType == BookSelectType::samepair) {
+            pairBookMap[pairId] = std::make_pair(theFenString, theMoves);
+        }
     }
     
-    lastPairIdx = pairId;
-    
     fenString = theFenString;
     moves = theMoves;
     return true;
 }
 
+void BookMng::setAlloneBook(const std::string& fenString, const std::vector<Move>& moves)
+{
+    theFenString = fenString;
+    theMoves = moves;
+    queryCnt = std::max(queryCnt, 1);
+}
+
+void BookMng::releasePair(int pairId)
+{
+    pairBookMap.erase(pairId);
+}
@@ -27,6 +27,7 @@
 #define book_h
 
 #include <stdio.h>
+#include <map>
 
 #include "../chess/chess.h"
 
@@ -149,7 +150,8 @@ namespace banksia {
         
         virtual bool load(const Json::Value& obj) override;
         virtual Json::Value saveToJson() const override;
-        bool getRandomBook(int pairId, std::string& fenString, std::vector<Move>& moves);
+        bool getRandomBook(int gameIdx, int pairId, std::string& fenString, std::vector<Move>& moves);
+        void releasePair(int pairId);
 
         static BookType string2BookType(const std::string& name);
         static std::string bookType2String(BookType type);
@@ -161,6 +163,10 @@ namespace banksia {
         size_t size() const;
 
         BookSelectType getBookSelectType() const { return bookSelectType; }
+        void setBookSelectType(BookSelectType type) { bookSelectType = type; }
+        
+        // the opening chosen for all games before, e.g. by a resumed tournament
+        void setAlloneBook(const std::string& fenString, const std::vector<Move>& moves);
 
     private:
         bool loadSingle(const Json::Value& obj);
@@ -169,10 +175,13 @@ namespace banksia {
         
         std::vector<Book*> bookList;
         
-        int queryCnt = 0, lastPairIdx = 1;
+        int queryCnt = 0;
         std::string theFenString;
         std::vector<Move> theMoves;
         
+        // openings of pairs which have some games started, for samepair
+        std::map<int, std::pair<std::string, std::vector<Move>>> pairBookMap;
+        
         std::string alloneFenString;
         std::vector<Move> alloneMoves;
         int seed = -1;
@@ -0,0 +1,184 @@
+/*
+ This file is part of Banksia.
+ 
+ Copyright (c) 2019 Nguyen Hong Pham
+ 
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+ 
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+ 
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+ */
+
+
+#include <cstdlib>
+
+#include "concurrencyctrl.h"
+
+using namespace banksia;
+
+bool ConcurrencyController::isValid() const
+{
+    return target > 0 && minTarget > 0 && minTarget <= maxTarget;
+}
+
+std::string ConcurrencyController::toString() const
+{
+    std::ostringstream stringStream;
+    stringStream << "Concurrency: " << getTarget();
+    if (limit < target) {
+        stringStream << " (limited from " << target << ")";
+    }
+    if (adaptive) {
+        std::lock_guard<std::mutex> dolock(reasonMutex);
+        stringStream << " (adaptive, " << minTarget << "-" << maxTarget << ", changes: " << changeCnt;
+        if (!lastReason.empty()) {
+            stringStream << ", last: " << lastReason;
+        }
+        stringStream << ")";
+    }
+    return stringStream.str();
+}
+
+void ConcurrencyController::setup(int _target, bool _adaptive, int _minTarget, int _maxTarget, int _coresPerGame)
+{
+    coresPerGame = std::max(1, _coresPerGame);
+    minTarget = std::max(1, _minTarget);
+    maxTarget = std::max(minTarget, _maxTarget);
+    target = std::max(1, _target);
+    if (_adaptive) {
+        target = std::min(maxTarget, std::max(minTarget, target.load()));
+    }
+    adaptive = _adaptive;
+    resetWindow();
+}
+
+void ConcurrencyController::setTarget(int n)
+{
+    // the operator takes control
+    adaptive = false;
+    target = std::max(1, n);
+}
+
+void ConcurrencyController::setAdaptive(bool enabled)
+{
+    // adapting starts from within the range, whatever the console set
+    if (enabled) {
+        target = std::min(maxTarget, std::max(minTarget, target.load()));
+    }
+    adaptive = enabled;
+}
+
+void ConcurrencyController::resetWindow()
+{
+    gameCnt = timeoutCnt = moveCnt = overshootCnt = npsCnt = 0;
+    npsRatioSum = 0;
+    windowStartTime = time(nullptr);
+}
+
+void ConcurrencyController::addSample(const ConcurrencySample& sample)
+{
+    if (!adaptive) {
+        return;
+    }
+    
+    gameCnt++;
+    timeoutCnt += sample.timeout ? 1 : 0;
+    moveCnt += sample.moves;
+    overshootCnt += sample.overshootMoves;
+    
+    for(int sd = 0; sd < 2; sd++) {
+        auto nps = sample.nps[sd];
+        if (nps <= 0) {
+            continue;
+        }
+        
+        auto it = npsRefMap.find(sample.names[sd]);
+        if (it == npsRefMap.end()) {
+            npsRefMap[sample.names[sd]] = nps;
+            continue;
+        }
+        
+        auto ratio = nps / it->second;
+        npsRatioSum += ratio;
+        npsCnt++;
+        
+        // slow games should not drag the reference down
+        if (ratio >= 0.85) {
+            it->second = it->second * 0.8 + nps * 0.2;
+        }
+    }
+}
+
+double ConcurrencyController::getHostLoad()
+{
+#ifdef _WIN32
+    return -1;
+#else
+    double loads[1];
+    return getloadavg(loads, 1) == 1 ? loads[0] : -1;
+#endif
+}
+
+bool ConcurrencyController::update()
+{
+    if (!adaptive) {
+        if (gameCnt) {
+            resetWindow();
+        }
+        return false;
+    }
+    
+    // wait for enough games and for the load average to catch up
+    auto oldTarget = target.load();
+    if (gameCnt < std::max(4, oldTarget) || time(nullptr) - windowStartTime < 60) {
+        return false;
+    }
+    
+    auto load = getHostLoad();
+    auto cores = getNumberOfCores();
+    
+    std::string reason;
+    if (timeoutCnt * 20 > gameCnt) {
+        reason = "time losses";
+    } else if (overshootCnt * 50 > moveCnt) {
+        reason = "move time overshoots";
+    } else if (npsCnt > 0 && npsRatioSum / npsCnt < 0.85) {
+        reason = "engines slowed down";
+    } else if (load > cores * 1.1) {
+        reason = "computer overloaded";
+    }
+    
+    // an unknown load (such as on Windows) is no sign of spare cores
+    auto newTarget = oldTarget;
+    if (!reason.empty()) {
+        newTarget = std::max(minTarget, oldTarget - std::max(1, oldTarget / 4));
+    } else if (load >= 0 && oldTarget < std::min(maxTarget, limit.load()) && load + coresPerGame <= cores) {
+        newTarget = oldTarget + 1;
+        reason = "spare cores";
+    }
+    
+    resetWindow();
+    
+    // the console may have changed the target meanwhile
+    if (newTarget == oldTarget || !adaptive || !target.compare_exchange_strong(oldTarget, newTarget)) {
+        return false;
+    }
+    
+    std::lock_guard<std::mutex> dolock(reasonMutex);
+    lastReason = reason;
+    changeCnt++;
+    return true;
+}
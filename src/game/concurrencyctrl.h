@@ -0,0 +1,104 @@
+/*
+ This file is part of Banksia.
+ 
+ Copyright (c) 2019 Nguyen Hong Pham
+ 
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+ 
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+ 
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+ */
+
+
+
+#ifndef concurrencyctrl_h
+#define concurrencyctrl_h
+
+#include <atomic>
+#include <climits>
+#include <map>
+#include <mutex>
+
+#include "../base/comm.h"
+
+namespace banksia {
+    
+    // Feedback of a completed game for the concurrency controller
+    class ConcurrencySample {
+    public:
+        std::string names[2];
+        double nps[2] = { 0, 0 };
+        int moves = 0, overshootMoves = 0;
+        bool timeout = false;
+    };
+    
+    // Adjusts the number of concurrent games within a range: one more game when
+    // the computer has spare cores, fewer games when engines lose on time,
+    // overshoot their move times, slow down or the computer is overloaded.
+    // The target can be set by the console anytime, that stops adapting
+    class ConcurrencyController : public Obj
+    {
+    public:
+        virtual const char* className() const override { return "ConcurrencyController"; }
+        virtual bool isValid() const override;
+        virtual std::string toString() const override;
+        
+        void setup(int target, bool adaptive, int minTarget, int maxTarget, int coresPerGame);
+        
+        int getTarget() const { return std::min(target.load(), limit.load()); }
+        // the target without the limit
+        int getWantedTarget() const { return target; }
+        void setTarget(int n);
+        
+        // hard cap from other resources (such as memory), over any target
+        void setLimit(int n) { limit = std::max(1, n); }
+        
+        bool isAdaptive() const { return adaptive; }
+        void setAdaptive(bool enabled);
+        
+        void addSample(const ConcurrencySample& sample);
+        
+        // return true if the target has been changed
+        bool update();
+        
+        // load average of the computer, negative if unknown
+        static double getHostLoad();
+        
+    private:
+        void resetWindow();
+        
+        std::atomic<int> target { 1 };
+        std::atomic<bool> adaptive { false };
+        std::atomic<int> limit { INT_MAX };
+        int minTarget = 1, maxTarget = 1, coresPerGame = 1;
+        
+        // samples since the last change
+        int gameCnt = 0, timeoutCnt = 0, moveCnt = 0, overshootCnt = 0;
+        int npsCnt = 0;
+        double npsRatioSum = 0;
+        std::map<std::string, double> npsRefMap;
+        
+        time_t windowStartTime = 0;
+        
+        // written by the tick thread, read by the console
+        mutable std::mutex reasonMutex;
+        int changeCnt = 0;
+        std::string lastReason;
+    };
+    
+} // namespace banksia
+
+#endif /* concurrencyctrl_h */
@@ -443,6 +443,7 @@ bool Config::load(const Json::Value& obj)
     
     if (app.isMember("ponderable")) ponderable = app["ponderable"].asBool(); // useful for Winboard only
     if (app.isMember("elo")) elo = app["elo"].asInt();
+    shellMode = app.isMember("shell") && app["shell"].asBool();
     
     variantSet.clear();
     if (app.isMember("variants")) {
@@ -506,6 +507,9 @@ Json::Value Config::saveToJson() const
     if (protocol == Protocol::wb) { // useful for Winboard only
         app["ponderable"] = ponderable;
     }
+    if (shellMode) {
+        app["shell"] = true;
+    }
 
     if (!variantSet.empty()) {
         Json::Value array;
@@ -794,6 +798,14 @@ bool ConfigMng::update(const Config& config)
     return insert(config);
 }
 
+void ConfigMng::setTrustedProfile(const std::string& name, bool trusted)
+{
+    auto it = configMap.find(name);
+    if (it != configMap.end()) {
+        it->second.trustedProfile = trusted;
+    }
+}
+
 bool ConfigMng::insert(const Config& config)
 {
     if (config.isValid() || (editingMode && !config.command.empty())) {
@@ -849,6 +861,16 @@ bool ConfigMng::loadOverrideOptions(const Json::Value& oo)
     return true;
 }
 
+void ConfigMng::setEngineMemory(int memory)
+{
+    std::lock_guard<std::mutex> dolock(memoryMutex);
+    if (overrideOptionMemory <= 0 || memory <= 0) {
+        return;
+    }
+    overrideOptionMemory = memory;
+    memoryOption.setDefaultValue(memory, 1, memory * 2);
+}
+
 void ConfigMng::setSyzygyPath(const std::string& path)
 {
 	syzygyPath = path;
@@ -887,9 +909,12 @@ Option ConfigMng::getOverrideOption(const std::string& name)
 		if (overrideOptionThreads > 0 && (str == "threads" || str == "cores")) {
 			option = threadOption;
 			option.name = name;
-		} else if (overrideOptionMemory > 0 && (str == "hash" || str == "memory")) {
-			option = memoryOption;
-			option.name = name;
+		} else if (str == "hash" || str == "memory") {
+			std::lock_guard<std::mutex> dolock(memoryMutex);
+			if (overrideOptionMemory > 0) {
+				option = memoryOption;
+				option.name = name;
+			}
 		} else if (!syzygyPath.empty() && str.find("syzygy") != std::string::npos && str.find("path") != std::string::npos) {
 			option = syzygyOption;
 			option.name = name;
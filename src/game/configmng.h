@@ -27,6 +27,7 @@
 
 #include <vector>
 #include <set>
+#include <mutex>
 
 #include "player.h"
 
@@ -139,6 +140,8 @@ namespace banksia {
         std::vector<Option> optionList;
         
         bool ponderable = true; // for Winboard protocol only
+        bool shellMode = false; // run the command by the shell instead of directly
+        bool trustedProfile = false; // not saved, the engine file is unchanged since probed, its options are not parsed again
     };
     
     class ConfigMng : public Obj, public JsonSavable
@@ -160,6 +163,7 @@ namespace banksia {
         bool update(const std::string& oldname, const Config&);
         bool update(const Config&);
         bool insert(const Config&);
+        void setTrustedProfile(const std::string& name, bool trusted);
         
         bool empty() const;
         
@@ -190,8 +194,11 @@ namespace banksia {
             return overrideOptionMode ? overrideOptionThreads : 0;
         }
         int getEngineMemory() const {
+            std::lock_guard<std::mutex> dolock(memoryMutex);
             return overrideOptionMode ? overrideOptionMemory : 0;
         }
+        // for engines started from now, affective only when memory is overridden
+        void setEngineMemory(int memory);
 
     protected:
         Json::Value createJsonForSaving() override;
@@ -209,6 +216,9 @@ namespace banksia {
 		std::string syzygyPath;
 
 		Option threadOption, memoryOption, syzygyOption;
+        
+        // memory is changed by the tournament while engine threads send their options
+        mutable std::mutex memoryMutex;
     };
     
     extern ConfigMng configMng;
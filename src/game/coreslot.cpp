@@ -0,0 +1,186 @@
+/*
+ This file is part of Banksia.
+ 
+ Copyright (c) 2019 Nguyen Hong Pham
+ 
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+ 
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+ 
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+ */
+
+
+#include <fstream>
+
+#ifdef __linux__
+#include <sched.h>
+#include <dirent.h>
+#endif
+
+#include "coreslot.h"
+
+using namespace banksia;
+
+bool CoreSlotMng::isValid() const
+{
+    return !slots.empty();
+}
+
+std::string CoreSlotMng::toString() const
+{
+    std::ostringstream stringStream;
+    stringStream << "Core slots: " << slots.size() << ", cores per slot: " << coresPerSlot << "; ";
+    return stringStream.str();
+}
+
+#ifdef __linux__
+// parse lists such as "0-3,8-11"
+static std::vector<int> parseCpuList(const std::string& str)
+{
+    std::vector<int> vec;
+    for(auto && s : splitString(str, ',')) {
+        auto p = s.find('-');
+        auto from = std::atoi(s.c_str()), to = p == std::string::npos ? from : std::atoi(s.c_str() + p + 1);
+        for(auto i = from; i <= to; i++) {
+            vec.push_back(i);
+        }
+    }
+    return vec;
+}
+#endif
+
+std::vector<std::vector<int>> CoreSlotMng::getNodeCores()
+{
+    std::vector<std::vector<int>> nodes;
+    
+#ifdef __linux__
+    cpu_set_t allowedSet;
+    CPU_ZERO(&allowedSet);
+    auto hasAllowedSet = sched_getaffinity(0, sizeof(allowedSet), &allowedSet) == 0;
+    
+    for(int i = 0; ; i++) {
+        std::ifstream file("/sys/devices/system/node/node" + std::to_string(i) + "/cpulist");
+        if (!file) {
+            break;
+        }
+        std::string line;
+        std::getline(file, line);
+        
+        std::vector<int> cores;
+        for(auto && cpu : parseCpuList(line)) {
+            if (!hasAllowedSet || (cpu < CPU_SETSIZE && CPU_ISSET(cpu, &allowedSet))) {
+                cores.push_back(cpu);
+            }
+        }
+        if (!cores.empty()) {
+            nodes.push_back(cores);
+        }
+    }
+    
+    if (nodes.empty() && hasAllowedSet) {
+        std::vector<int> cores;
+        for(int cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+            if (CPU_ISSET(cpu, &allowedSet)) {
+                cores.push_back(cpu);
+            }
+        }
+        nodes.push_back(cores);
+    }
+#endif
+    
+    if (nodes.empty()) {
+        std::vector<int> cores;
+        for(int cpu = 0, n = getNumberOfCores(); cpu < n; cpu++) {
+            cores.push_back(cpu);
+        }
+        nodes.push_back(cores);
+    }
+    return nodes;
+}
+
+int CoreSlotMng::setup(int _coresPerSlot)
+{
+    coresPerSlot = std::max(1, _coresPerSlot);
+    slots.clear();
+    
+    for(auto && cores : getNodeCores()) {
+        for(size_t i = 0; i + coresPerSlot <= cores.size(); i += coresPerSlot) {
+            slots.push_back(std::vector<int>(cores.begin() + i, cores.begin() + i + coresPerSlot));
+        }
+    }
+    
+    busyVec.assign(slots.size(), false);
+    return int(slots.size());
+}
+
+int CoreSlotMng::acquire()
+{
+    for(size_t i = 0; i < busyVec.size(); i++) {
+        if (!busyVec[i]) {
+            busyVec[i] = true;
+            return int(i);
+        }
+    }
+    return -1;
+}
+
+void CoreSlotMng::release(int slot)
+{
+    if (slot >= 0 && slot < int(busyVec.size())) {
+        busyVec[slot] = false;
+    }
+}
+
+bool CoreSlotMng::setProcessAffinity(int pid, const std::vector<int>& cores)
+{
+#ifdef __linux__
+    if (pid <= 0 || cores.empty()) {
+        return false;
+    }
+    
+    cpu_set_t cpuSet;
+    CPU_ZERO(&cpuSet);
+    for(auto && c : cores) {
+        CPU_SET(c, &cpuSet);
+    }
+    
+    // engines may have created their search threads already
+    auto dir = opendir(("/proc/" + std::to_string(pid) + "/task").c_str());
+    if (!dir) {
+        return sched_setaffinity(pid, sizeof(cpuSet), &cpuSet) == 0;
+    }
+    
+    auto ok = true;
+    while (auto entry = readdir(dir)) {
+        auto tid = std::atoi(entry->d_name);
+        if (tid > 0 && sched_setaffinity(tid, sizeof(cpuSet), &cpuSet) != 0) {
+            ok = false;
+        }
+    }
+    closedir(dir);
+    return ok;
+#else
+    return false;
+#endif
+}
+
+std::vector<int> CoreSlotMng::getCores(int slot) const
+{
+    if (slot >= 0 && slot < int(slots.size())) {
+        return slots[slot];
+    }
+    return std::vector<int>();
+}
@@ -0,0 +1,68 @@
+/*
+ This file is part of Banksia.
+ 
+ Copyright (c) 2019 Nguyen Hong Pham
+ 
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+ 
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+ 
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+ */
+
+
+#ifndef coreslot_h
+#define coreslot_h
+
+#include "../base/comm.h"
+
+namespace banksia {
+    
+    // Splits computer cores into disjoint slots, one slot per concurrent game.
+    // A slot never spans NUMA nodes. Engines of a game are pinned to its slot
+    class CoreSlotMng : public Obj
+    {
+    public:
+        virtual const char* className() const override { return "CoreSlotMng"; }
+        virtual bool isValid() const override;
+        virtual std::string toString() const override;
+        
+        // return the number of slots
+        int setup(int coresPerSlot);
+        
+        int getSlotCount() const { return int(slots.size()); }
+        int getCoresPerSlot() const { return coresPerSlot; }
+        
+        // return -1 if all slots are busy
+        int acquire();
+        void release(int slot);
+        
+        std::vector<int> getCores(int slot) const;
+        
+        // sets of cores which are usable by this process, one set per NUMA node
+        static std::vector<std::vector<int>> getNodeCores();
+        
+        // pin all threads of a running process
+        static bool setProcessAffinity(int pid, const std::vector<int>& cores);
+        
+    private:
+        int coresPerSlot = 0;
+        std::vector<std::vector<int>> slots;
+        std::vector<bool> busyVec;
+    };
+    
+} // namespace banksia
+
+#endif /* coreslot_h */
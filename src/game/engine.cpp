@@ -35,6 +35,8 @@ using namespace banksia;
 ////////////////////////////////////
 Engine::~Engine()
 {
+    logFilter.flush(getName());
+    
     if (processId && isRunning(processId)) {
         std::cout << "Warning: a chess engine/program (" << name << ", PID: " << processId << ") refused to stop. Try to kill!" << std::endl;
         TinyProcessLib::Process::kill(processId, true);
@@ -55,16 +57,25 @@ void Engine::tickWork()
     tick_state++;
     tick_idle++;
     
-    if (isIdleCrash()) {
-        auto str = name + " stalled too long. Stopped!";
+    auto pingOverdue = isPingOverdue();
+    if (pingOverdue || isIdleCrash()) {
+        auto str = name + (pingOverdue ? " not responding. Stopped!" : " stalled too long. Stopped!");
         if (messageLogger)
             (messageLogger)(getAppName(), str, LogType::system);
         setState(PlayerState::stopped);
+        // the game reports the crash at its next tick, the hung process is terminated meanwhile
+        if (process) {
+            process->kill(false);
+        }
         return;
     }
     
     if (tick_deattach > 0) tick_deattach--;
     
+    if (process) {
+        process->flush_stdin();
+    }
+    
     if (tick_being_kill > 0 && process) {
         tick_being_kill--;
         if (tick_being_kill == 0) {
@@ -81,15 +92,85 @@ void Engine::tickWork()
 void Engine::tickPing()
 {
     tick_ping++;
-    if (tick_ping >= tick_period_ping) {
+    if (tick_ping >= getPingPeriod()) {
         resetPing();
-        sendPing();
+        if (pingSentTime == 0) {
+            sendPing();
+        }
     }
 }
 
 bool Engine::isIdleCrash() const
 {
-    return tick_idle > tick_period_idle_dead;
+    // silent engines which are not pinged while searching are stopped by their clocks
+    auto tc = timeController;
+    if (computingState == EngineComputingState::thinking && !isPingableWhileThinking()
+        && tc && (tc->mode == TimeControlMode::standard || tc->mode == TimeControlMode::movetime)) {
+        return false;
+    }
+    return tick_idle > int(getResponseDeadline() * 2);
+}
+
+double Engine::getResponseDeadline() const
+{
+    auto tc = timeController;
+    // starting engines may load large files (networks, tablebases) before answering,
+    // so may ones setting options or clearing hash until they answer a ping
+    if (state < PlayerState::ready || tc == nullptr || setupSentTime != 0) {
+        return tick_period_idle_dead / 2;
+    }
+    
+    double moveTime;
+    switch (tc->mode) {
+        case TimeControlMode::movetime:
+            moveTime = tc->time;
+            break;
+        case TimeControlMode::standard:
+            moveTime = tc->time / (tc->moves > 0 ? tc->moves : 40) + tc->increment;
+            break;
+        default:
+            return tick_period_idle_dead / 2;
+    }
+    return std::max(3.0, std::min(double(tick_period_idle_dead / 2), moveTime * 3 + tc->margin));
+}
+
+int Engine::getPingPeriod() const
+{
+    // in ticks, two pings per deadline
+    return std::min(tick_period_ping, std::max(2, int(getResponseDeadline())));
+}
+
+bool Engine::isPingOverdue() const
+{
+    int64_t sent = pingSentTime;
+    if (sent == 0 || (computingState == EngineComputingState::thinking && !isPingableWhileThinking())) {
+        return false;
+    }
+    
+    auto now = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    return double(now - sent) > getResponseDeadline() * 1000;
+}
+
+void Engine::pingSent()
+{
+    // the deadline counts from the oldest unanswered ping
+    int64_t expected = 0;
+    auto now = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    pingSentTime.compare_exchange_strong(expected, now);
+}
+
+void Engine::setupCommandSent()
+{
+    setupSentTime = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void Engine::pongReceived()
+{
+    // only a ping sent after the setup tells it is done
+    if (pingSentTime >= setupSentTime) {
+        setupSentTime = 0;
+    }
+    pingSentTime = 0;
 }
 
 bool Engine::exited() const
@@ -131,10 +212,16 @@ void Engine::read_stderr(const char *bytes, size_t n)
     assert(false); // don't use
 }
 
+// Called by the pipe reader thread, lines are only queued here to keep the pipe drained
 void Engine::read_stdout(const char *bytes, size_t n)
 {
-    // check before use since it may be being deleted
-    if (!isAttached() || n <= 0) {
+    // the pipe has been read out
+    if (n == 0) {
+        trim(lastIncompletedStdout);
+        if (!lastIncompletedStdout.empty()) {
+            outputQueue.push(lastIncompletedStdout);
+        }
+        outputQueue.finish();
         return;
     }
     
@@ -173,13 +260,37 @@ void Engine::read_stdout(const char *bytes, size_t n)
     
     
     for (auto && line : vec) {
-        parseLine(line);
+        outputQueue.push(line);
+    }
+    
+    if (!vec.empty()) {
+        outputQueue.notify();
+    }
+}
+
+void Engine::processOutput()
+{
+    std::string line;
+    while (outputQueue.pop(line)) {
+        // check before use since it may be being deleted
+        if (isAttached() || standbyMode) {
+            parseLine(line);
+        }
     }
 }
 
 void Engine::parseLine(const std::string& line)
 {
-    log(line, LogType::fromEngine);
+    if (messageLogger) {
+        std::string releasedLine;
+        auto wanted = logFilter.pass(line, releasedLine);
+        if (!releasedLine.empty()) {
+            log(releasedLine, LogType::fromEngine);
+        }
+        if (wanted) {
+            log(line, LogType::fromEngine);
+        }
+    }
     
     auto p = line.find(' ');
     auto cmdString = p == std::string::npos ? line : line.substr(0, p);
@@ -195,10 +306,23 @@ void Engine::parseLine(const std::string& line)
     parseLine(it->second, cmdString, line);
 }
 
+void Engine::setCpuAffinity(const std::vector<int>& cores)
+{
+    cpuAffinity = cores;
+    if (process) {
+        CoreSlotMng::setProcessAffinity(int(processId), cores);
+    }
+}
+
 bool Engine::kickStart()
 {
     resetPing();
     
+    // started in advance, the process is being launched or is running
+    if (pThread) {
+        return true;
+    }
+    
     if (process == nullptr) {
         setState(PlayerState::none);
         
@@ -213,33 +337,69 @@ bool Engine::kickStart()
         
         assert(!command.empty());
         
+        // a command of an executable file runs directly, without a shell
+        std::vector<TinyProcessLib::Process::string_type> arguments;
+#ifndef _WIN32
+        if (!config.shellMode && isExecutable(command)) {
+            arguments.push_back(command);
+            arguments.insert(arguments.end(), config.argumentList.begin(), config.argumentList.end());
+        } else {
+            for(auto && s : config.argumentList) {
+                command += " " + s;
+            }
+        }
+#endif
+        
+        processThreadRunning = true;
         std::thread processThread([=]() {
             TinyProcessLib::Config config;
             config.buffer_size = process_buffer_size;
-            TinyProcessLib::Process engineProcess(
-                                                  command,
-                                                  workingFolder,
-                                                  [=](const char *bytes, size_t n) {
-                                                      read_stdout(bytes, n);
-                                                  }, [=](const char *bytes, size_t n) {
-                                                      read_stdout(bytes, n);
-                                                  },
-                                                  true, config);
+            config.pipe_size = process_pipe_size;
+            config.nonblocking_stdin = true;
+            config.cpu_affinity = cpuAffinity;
+            
+            auto readFunc = [=](const char *bytes, size_t n) {
+                read_stdout(bytes, n);
+            };
             
-            processId = engineProcess.get_id();
-            process = &engineProcess;
+            // the output queue takes one producer only. Windows reads stdout
+            // and stderr by two threads, stderr is redirected to stdout there
+#ifdef _WIN32
+            std::function<void(const char *bytes, size_t n)> readErrFunc = nullptr;
+#else
+            std::function<void(const char *bytes, size_t n)> readErrFunc = readFunc;
+#endif
+            std::unique_ptr<TinyProcessLib::Process> engineProcess(arguments.empty() ?
+                                                                   new TinyProcessLib::Process(command, workingFolder, readFunc, readErrFunc, true, config) :
+                                                                   new TinyProcessLib::Process(arguments, workingFolder, readFunc, readErrFunc, true, config));
+            
+            processId = engineProcess->get_id();
+            process = engineProcess.get();
             setState(PlayerState::starting);
             write(protocolString());
 
-            engineProcess.get_exit_status();
+            // parse the output of the engine until it exits and its output is read out.
+            // The exit status is taken after that since it joins the pipe reader,
+            // which may be waiting for room in the queue
+            int exitStatus;
+            while (!outputQueue.isFinished() || !engineProcess->try_get_exit_status(exitStatus)) {
+                outputQueue.wait(100);
+                processOutput();
+            }
+            processOutput();
             
-            // engine has just exited
+            // engine has just exited, the process is cleared last since
+            // it tells the engine could be deleted
             if (process) {
-                process = nullptr;
                 setState(PlayerState::stopped);
                 finished();
+                process = nullptr;
             }
+            
+            // joins the pipe readers, which call back into this engine
+            engineProcess.reset();
             pThread = nullptr;
+            processThreadRunning = false;
         });
         
         pThread = &processThread;
@@ -254,11 +414,13 @@ bool Engine::kickStart()
 void Engine::attach(ChessBoard* board, const GameTimeController* timeController, std::function<void(const Move&, const std::string&, const Move&, double, EngineComputingState)> moveFunc, std::function<void()> resignFunc)
 {
     Player::attach(board, timeController, moveFunc, resignFunc);
+    standbyMode = false;
     tick_deattach = -1;
     tick_idle = 0;
     
     if (board == nullptr) {
         messageLogger = nullptr;
+        logFilter.flush(getName());
     }
 }
 
@@ -269,7 +431,7 @@ bool Engine::isSafeToDeattach() const
 
 bool Engine::isSafeToDelete() const
 {
-    return process == nullptr;
+    return process == nullptr && !processThreadRunning;
 }
 
 bool Engine::stopThinking()
@@ -283,10 +445,24 @@ bool Engine::isWritable() const
 }
 
 bool Engine::write(const std::string& str)
+{
+    return write(std::vector<std::string> { str });
+}
+
+bool Engine::write(const std::vector<std::string>& lines)
 {
     if (state >= PlayerState::starting && state < PlayerState::stopped && process) {
-        process->write(str + "\n");
-        log(str, LogType::toEngine);
+        std::vector<std::string> pieces;
+        for(auto && str : lines) {
+            pieces.push_back(str + "\n");
+        }
+        // stdin is non-blocking, what the engine can't take yet is sent later
+        process->write(pieces);
+        writeTime = std::chrono::system_clock::now();
+        
+        for(auto && str : lines) {
+            log(str, LogType::toEngine);
+        }
         return true;
     }
     return false;
@@ -28,12 +28,15 @@
 
 #include <vector>
 #include <set>
+#include <atomic>
 
 #include "../3rdparty/process/process.hpp"
 #include "../chess/chess.h"
 
 #include "player.h"
 #include "configmng.h"
+#include "outputqueue.h"
+#include "logfilter.h"
 
 namespace banksia {
     enum class LogType {
@@ -60,6 +63,20 @@ namespace banksia {
         
         void setMessageLogger(std::function<void(const std::string&, const std::string&, LogType logType)> messageLogger);
         
+        // noisy thinking output is dropped before reaching the message logger
+        void setLogVerbosity(LogVerbosity verbosity) { logFilter.setVerbosity(verbosity); }
+        
+        // cores the engine will be pinned to, a running engine is pinned immediately
+        void setCpuAffinity(const std::vector<int>& cores);
+        
+        // started in advance, not attached to any game yet
+        void setStandbyMode(bool mode) { standbyMode = mode; }
+        
+        int getProcessId() const { return int(processId); }
+        
+        // hash (UCI) or memory (Winboard) in MB sent to the engine, zero if not sent
+        int getHashSize() const { return hashSize; }
+        
     public:
         virtual bool kickStart() override;
         virtual bool stopThinking() override;
@@ -94,6 +111,7 @@ namespace banksia {
         
         void read_stdout(const char *bytes, size_t n);
         void read_stderr(const char *bytes, size_t n);
+        void processOutput();
         
         bool exited() const;
         
@@ -102,24 +120,50 @@ namespace banksia {
         virtual void finished() {}
         virtual void tickPing();
         
+        // responsiveness watchdog, a ping must be answered within a deadline scaled to the time control
+        double getResponseDeadline() const;
+        int getPingPeriod() const;
+        bool isPingOverdue() const;
+        virtual bool isPingableWhileThinking() const { return false; }
+        void pingSent();
+        void pongReceived();
+        // options, new games may allocate or clear large hash tables before the next answer
+        void setupCommandSent();
+        
     public:
         EngineComputingState computingState = EngineComputingState::idle;
         Config config;
         
     protected:
         bool write(const std::string&);
+        // a logical group of commands is sent in one system call
+        bool write(const std::vector<std::string>&);
         int tick_deattach = -1;
         int tick_ping, tick_idle, tick_being_kill = -1; //, tick_stopping = 0;
+        
+        // steady clock in ms when the pending ping was sent, zero if none
+        std::atomic<int64_t> pingSentTime { 0 };
+        // steady clock in ms of the last setup command, zero once a later ping is answered
+        std::atomic<int64_t> setupSentTime { 0 };
         std::function<void(const std::string&, const std::string&, LogType)> messageLogger = nullptr;
 
-        int correctCmdCnt = 0;
+        std::atomic<int> correctCmdCnt { 0 };
+        std::chrono::system_clock::time_point writeTime; // when the last commands were handed to the engine
         TinyProcessLib::Process::id_type processId = 0;
+        int hashSize = 0;
 
     private:
         const int process_buffer_size = 16 * 1024;
+        const int process_pipe_size = 1024 * 1024; // room for engine bursts, Linux only
+        std::vector<int> cpuAffinity;
+        std::atomic<bool> standbyMode { false };
         std::string lastIncompletedStdout;
+        OutputQueue outputQueue;
+        EngineLogFilter logFilter;
         TinyProcessLib::Process* process = nullptr;
         std::thread* pThread = nullptr;
+        // the process thread still uses this engine
+        std::atomic<bool> processThreadRunning { false };
     };
     
     
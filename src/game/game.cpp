@@ -138,6 +138,37 @@ void Game::kickStart()
     setState(GameState::begin);
 }
 
+bool Game::isNearlyOver(int expectedPly) const
+{
+    if (state >= GameState::stopped) {
+        return true;
+    }
+    if (state != GameState::playing) {
+        return false;
+    }
+    
+    auto ply = int(board.histList.size());
+    if (expectedPly > 0 && ply * 10 >= expectedPly * 9) {
+        return true;
+    }
+    
+    if (gameConfig.adjudicationMode) {
+        if (gameConfig.adjudicationMaxGameLength && ply + 10 >= gameConfig.adjudicationMaxGameLength) {
+            return true;
+        }
+        if (gameConfig.adjudicationEgtbMode && board.getPieceCount() <= gameConfig.adjudicationMaxPieces + 1) {
+            return true;
+        }
+        // some scores have been over adjudication bounds
+        for(int sd = 0; sd < 2; sd++) {
+            if (resignLossCnt[sd] || drawCnt[sd]) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
 void Game::newGame()
 {
     // Include opening
@@ -173,6 +204,7 @@ void Game::startThinking(Move pondermove)
     
     players[1 - sd]->goPonder(pondermove);
     players[sd]->go();
+    timeController.startMoveTimeClock(players[sd]->getGoTime());
 }
 
 void Game::pause()
@@ -211,6 +243,10 @@ void Game::moveFromPlayer(const Move& move, const std::string& moveString, const
             lastHist.nodes = players[sd]->getNodes();
             timeController.udateClockAfterMove(timeConsumed, lastHist.move.piece.side, int(board.histList.size()));
             
+            if (gameConfig.adjudicationMode && checkScoreAdjudication()) {
+                return;
+            }
+            
             startThinking(gameConfig.ponderMode ? ponderMove : Move::illegalMove);
         }
     } else if (oldState == EngineComputingState::pondering) { // missed ponderhit, stop called
@@ -235,11 +271,15 @@ bool Game::make(const Move& move, const std::string& moveString)
                 return false;
             }
             
-            if (gameConfig.adjudicationEgtbMode) {
+            // a failed probe (e.g. missing tables) won't succeed until the material changes
+            if (gameConfig.adjudicationEgtbMode
+                && board.getPieceCount() <= gameConfig.adjudicationMaxPieces
+                && board.getMaterialKey() != tbFailedMaterialKey) {
                 bool tberror;
                 auto result = board.probeSyzygy(gameConfig.adjudicationMaxPieces, tberror);
                 if (result.result == ResultType::noresult) {
-                    if (tberror && !board.histList.back().cap.isEmpty()) { // make message only for capture moves to avoid too many
+                    if (tberror) {
+                        tbFailedMaterialKey = board.getMaterialKey();
                         auto msg = "Error: unable to probe tablebase, position invalid, illegal or not in tablebase";
                         (messageLogger)(getAppName(), msg, LogType::system);
                     }
@@ -265,6 +305,56 @@ bool Game::make(const Move& move, const std::string& moveString)
     return false;
 }
 
+// Scores are from views of engines which made moves
+bool Game::checkScoreAdjudication()
+{
+    auto resignMode = gameConfig.adjudicationResignMoveCount > 0;
+    auto drawMode = gameConfig.adjudicationDrawMoveCount > 0;
+    if (!resignMode && !drawMode) {
+        return false;
+    }
+    
+    auto& hist = board.histList.back();
+    auto sd = static_cast<int>(hist.move.piece.side);
+    
+    // no info from the engine (e.g. book or instant moves), can't judge
+    if (hist.depth <= 0) {
+        resignLossCnt[sd] = resignWinCnt[sd] = drawCnt[sd] = 0;
+        return false;
+    }
+    
+    if (resignMode) {
+        resignLossCnt[sd] = hist.score <= -gameConfig.adjudicationResignScore ? resignLossCnt[sd] + 1 : 0;
+        resignWinCnt[sd] = hist.score >= gameConfig.adjudicationResignScore ? resignWinCnt[sd] + 1 : 0;
+        
+        for(int loser = 0; loser < 2; loser++) {
+            if (resignLossCnt[loser] >= gameConfig.adjudicationResignMoveCount
+                && (!gameConfig.adjudicationResignBothAgree || resignWinCnt[1 - loser] >= gameConfig.adjudicationResignMoveCount)) {
+                auto winner = static_cast<Side>(1 - loser);
+                auto msg = "Score adjudication: " + players[loser]->getName() + " resigned, score " + std::to_string(hist.score);
+                (messageLogger)(getAppName(), msg, LogType::system);
+                gameOver(winner, ReasonType::scoreadjudication);
+                return true;
+            }
+        }
+    }
+    
+    if (drawMode) {
+        drawCnt[sd] = std::abs(hist.score) <= gameConfig.adjudicationDrawScore ? drawCnt[sd] + 1 : 0;
+        
+        if (int(board.histList.size()) >= gameConfig.adjudicationDrawStartPly
+            && drawCnt[W] >= gameConfig.adjudicationDrawMoveCount
+            && drawCnt[B] >= gameConfig.adjudicationDrawMoveCount) {
+            auto msg = "Score adjudication: draw, score " + std::to_string(hist.score);
+            (messageLogger)(getAppName(), msg, LogType::system);
+            gameOver(Result(ResultType::draw, ReasonType::scoreadjudication));
+            return true;
+        }
+    }
+    
+    return false;
+}
+
 void Game::gameOver(Side winner, ReasonType reasonType)
 {
     Result result(winner == Side::white ? ResultType::win : ResultType::loss, reasonType);
@@ -306,6 +396,31 @@ std::string Game::getGameTitleString(bool includeResult) const
     return str;
 }
 
+bool Game::checkCrash()
+{
+    auto stoppedCnt = 0;
+    for(int sd = 0; sd < 2; sd++) {
+        if (players[sd] && players[sd]->getState() == PlayerState::stopped) {
+            stoppedCnt++;
+        }
+    }
+    
+    if (stoppedCnt == 0) {
+        return false;
+    }
+    
+    Result result;
+    result.reason = ReasonType::crash;
+    if (stoppedCnt == 2) { // both crash
+        result.result = ResultType::draw;
+    } else {
+        result.result = players[W] && players[W]->getState() == PlayerState::stopped ? ResultType::loss : ResultType::win;
+    }
+    
+    gameOver(result);
+    return true;
+}
+
 bool Game::checkTimeOver()
 {
     if (timeController.isTimeOver(board.side)) {
@@ -379,16 +494,8 @@ void Game::tickWork()
             }
 
             // engines crashed
-            Result result;
-            result.reason = ReasonType::crash;
             setState(GameState::stopped);
-            if (stoppedCnt == 2) { // both crash
-                result.result = ResultType::draw;
-            } else {
-                result.result = players[W]->getState() == PlayerState::stopped ? ResultType::loss : ResultType::win;
-            }
-            
-            gameOver(result);
+            checkCrash();
             break;
         }
             
@@ -402,7 +509,8 @@ void Game::tickWork()
             
             // std::lock_guard<std::mutex> dolock(criticalMutex); // avoid conflicting with moveFromPlayer
             if (criticalMutex.try_lock()) {
-                if (state == GameState::playing) {
+                // a crashed or unresponsive engine frees the slot at once instead of waiting for its clock
+                if (state == GameState::playing && !checkCrash()) {
                     checkTimeOver();
                 }
                 criticalMutex.unlock();
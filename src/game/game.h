@@ -48,6 +48,11 @@ namespace banksia {
         bool adjudicationEgtbMode = true;
         int adjudicationMaxGameLength = 0;
         int adjudicationMaxPieces = 10;
+        
+        // by engines' scores (centipawns), set move counts zero to turn them off
+        int adjudicationResignScore = 1000, adjudicationResignMoveCount = 0;
+        bool adjudicationResignBothAgree = true;
+        int adjudicationDrawScore = 5, adjudicationDrawMoveCount = 0, adjudicationDrawStartPly = 80;
     };
     
     class Game : public Obj, public Tickable
@@ -92,6 +97,12 @@ namespace banksia {
         int getIdx() const;
         int getStateTick() const { return stateTick; }
         
+        // the game is ending or likely to end soon (expectedPly: average length of games, zero if unknown)
+        bool isNearlyOver(int expectedPly) const;
+        
+        int getCoreSlot() const { return coreSlot; }
+        void setCoreSlot(int slot) { coreSlot = slot; }
+        
         std::string toPgn(std::string event = "", std::string site = "", int round = -1, int gameIdx = -1, bool richMode = false);
         
         std::string getGameTitleString(bool includeResult = false) const;
@@ -100,10 +111,12 @@ namespace banksia {
         ChessBoard board;
         
     private:
+        bool checkCrash();
         bool checkTimeOver();
+        bool checkScoreAdjudication();
         
     private:
-        int idx, stateTick = 0;
+        int idx, stateTick = 0, coreSlot = -1;
         GameState state;
         GameConfig gameConfig;
         
@@ -115,6 +128,11 @@ namespace banksia {
         std::string startFen;
         std::vector<Move> startMoves;
         std::mutex criticalMutex;
+        
+        u64 tbFailedMaterialKey = 0;
+        
+        // consecutive moves of each side with scores over adjudication bounds
+        int resignLossCnt[2] = { 0, 0 }, resignWinCnt[2] = { 0, 0 }, drawCnt[2] = { 0, 0 };
     };
     
 } // namespace banksia
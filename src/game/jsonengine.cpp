@@ -23,7 +23,6 @@
  */
 
 
-#include <regex>
 #include <map>
 
 #include "jsonengine.h"
@@ -92,7 +91,7 @@ void JsonEngine::kickStart(std::function<void(Config* config)> _taskComplete)
     taskComplete = _taskComplete;
     
     setupEngine();
-    tick_test = tick_test_period;
+    testDeadline = std::chrono::steady_clock::now() + (config.protocol == Protocol::uci ? test_period_uci : test_period_wb);
     
     Engine::kickStart();
 }
@@ -105,8 +104,29 @@ const std::unordered_map<std::string, int>& JsonEngine::getEngineCmdMap() const
 void JsonEngine::parseLine(int cmdInt, const std::string& cmdString, const std::string& line)
 {
     if (cmdInt >= 0) {
-        usedCmdSet.insert(cmdString);
+        {
+            std::lock_guard<std::mutex> lock(cmdSetMutex);
+            usedCmdSet.insert(cmdString);
+        }
         engine->parseLine(cmdInt, cmdString, line);
+    } else {
+        badLineCnt++;
+        if (config.protocol == Protocol::uci && correctCmdCnt == 0
+            && (cmdString == "feature" || cmdString == "Error" || cmdString == "Illegal" || cmdString == "illegal"
+                || line.find("nknown command") != std::string::npos)) {
+            wbHint = true;
+        }
+    }
+    
+    if (eventNotifier && (engine->getState() == PlayerState::ready || wbHint || badLineCnt > max_bad_lines)) {
+        (eventNotifier)();
+    }
+}
+
+void JsonEngine::finished()
+{
+    if (eventNotifier) {
+        (eventNotifier)();
     }
 }
 
@@ -126,37 +146,63 @@ void JsonEngine::tickWork()
         return;
     }
     
+    // wb need tickWork to turn ready
+    if (config.protocol == Protocol::wb) {
+        engine->tickWork();
+    }
+    
+    checkProgress();
+}
+
+void JsonEngine::checkProgress()
+{
+    if (jsonstate != JsonEngineState::working) {
+        return;
+    }
+    
     auto st = engine->getState();
-    if (st == PlayerState::stopped) {
-        return completed(nullptr);
+    if (st == PlayerState::ready && correctCmdCnt > 0) {
+        completed(&engine->config);
+        return;
+    }
+    
+    // the program has exited
+    if (st == PlayerState::stopped || getState() == PlayerState::stopped) {
+        completed(nullptr);
+        return;
     }
     
-    if (st == PlayerState::ready) {
-        if (correctCmdCnt == 0) { // hm, wait for a pong (in case of wb)
+    if (originalProtocol == Protocol::none && config.protocol == Protocol::uci) {
+        if (wbHint || (correctCmdCnt == 0 && badLineCnt > max_bad_lines)) {
+            switchToWb();
             return;
         }
-        completed(&engine->config);
+    } else if (correctCmdCnt == 0 && badLineCnt > max_bad_lines) {
+        completed(nullptr);
         return;
     }
     
-    // wb need tickWork to turn ready
-    if (config.protocol == Protocol::wb) {
-        engine->tickWork();
+    auto now = std::chrono::steady_clock::now();
+    if (now < testDeadline) {
+        return;
     }
     
-    tick_test--;
-    if (tick_test > 0) {
-        return;
+    size_t usedCmdCnt;
+    bool featureUsed;
+    {
+        std::lock_guard<std::mutex> lock(cmdSetMutex);
+        usedCmdCnt = usedCmdSet.size();
+        featureUsed = usedCmdSet.find("feature") != usedCmdSet.end();
     }
     
-    if ((correctCmdCnt > 6 && usedCmdSet.size() > 2) || (correctCmdCnt > 3 && usedCmdSet.find("feature") != usedCmdSet.end())) {
+    if ((correctCmdCnt > 6 && usedCmdCnt > 2) || (correctCmdCnt > 3 && featureUsed)) {
         completed(&engine->config);
         return;
     }
     
     if (tryNum > 0 && correctCmdCnt > 2) {
         tryNum--;
-        tick_test = tick_test_period;
+        testDeadline = now + (config.protocol == Protocol::uci ? test_period_uci : test_period_wb);
         return;
     }
     
@@ -165,18 +211,25 @@ void JsonEngine::tickWork()
         return;
     }
     
+    switchToWb();
+}
+
+void JsonEngine::switchToWb()
+{
     setState(PlayerState::stopping);
     
     config.protocol = Protocol::wb;
     setupEngine();
     
-    usedCmdSet.clear();
+    {
+        std::lock_guard<std::mutex> lock(cmdSetMutex);
+        usedCmdSet.clear();
+    }
     correctCmdCnt = 0;
+    badLineCnt = 0;
+    wbHint = false;
     tick_idle = 0;
-    tick_test = tick_test_period;
+    testDeadline = std::chrono::steady_clock::now() + test_period_wb;
     tryNum = 3;
     write(engine->protocolString());
 }
-
-
-
@@ -27,6 +27,9 @@
 #define jsonengineplayer_h
 
 #include <stdio.h>
+#include <atomic>
+#include <chrono>
+#include <mutex>
 
 #include "engine.h"
 #include "uciengine.h"
@@ -51,6 +54,11 @@ namespace banksia {
         using Engine::kickStart;
         void kickStart(std::function<void(Config* config)> taskComplete);
         void tickWork() override;
+        
+        // called (from reading threads) when the engine has sent something decisive or exited
+        void setEventNotifier(std::function<void()> notifier) { eventNotifier = notifier; }
+        // decide the protocol or dismiss the program as soon as possible, taskComplete is called from here
+        void checkProgress();
 
         bool isFinished() const {
             return jsonstate == JsonEngineState::done;
@@ -72,21 +80,33 @@ namespace banksia {
     private:
         void completed(Config* config);
         void setupEngine();
+        void switchToWb();
+        void finished() override;
         
         JsonEngineState jsonstate = JsonEngineState::none;
         Protocol originalProtocol;
 
         std::function<void(Config* config)> taskComplete = nullptr;
+        std::function<void()> eventNotifier = nullptr;
 
-        const int tick_test_period = 24;    // 12s
-        const int tick_test_period_wb = 50; // 25 seconds
-        int tick_test = 0, tryNum = 3;      // 4 x 12 -> 48s
+        // waiting periods for an answer, extended a few times for engines which are answering
+        const std::chrono::milliseconds test_period_uci { 6000 };
+        const std::chrono::milliseconds test_period_wb { 12000 };
+        std::chrono::steady_clock::time_point testDeadline;
+        int tryNum = 3;
+        
+        // lines which are not of the testing protocol, a program printing many of them is not an engine
+        const int max_bad_lines = 32;
+        std::atomic<int> badLineCnt { 0 };
+        // a Winboard engine usually answers "uci" with an error or its features
+        std::atomic<bool> wbHint { false };
         
         Engine* engine = nullptr;
         
         UciEngine uciEngine;
         WbEngine wbEngine;
         
+        std::mutex cmdSetMutex;
         std::set<std::string> usedCmdSet;
     };
     
@@ -27,6 +27,19 @@
 #include <fstream>
 #include <sstream>
 
+#ifndef _WIN32
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <mutex>
+#include <thread>
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
 #include "jsonmaker.h"
 
 using namespace banksia;
@@ -36,10 +49,21 @@ static const std::string jsonTourString =
 "    \"base\" :\n"
 "    {\n"
 "        \"concurrency\" : 2,\n"
+"        \"core pinning\" : false,\n"
+"        \"adaptive concurrency\" : false,\n"
+"        \"concurrency min\" : 1,\n"
+"        \"concurrency max\" : 0,\n"
+"        \"prestart games\" : 0,\n"
+"        \"max engine launches\" : 2,\n"
+"        \"memory budget\" : false,\n"
+"        \"memory reserve\" : 1024,\n"
+"        \"memory policy\" : \"hash\",\n"
+"        \"memory min hash\" : 16,\n"
+"        \"match order\" : \"listed\",\n"
 "        \"event\" : \"Computer event\",\n"
 "        \"games per pair\" : 2,\n"
 "        \"swap pair sides\" : true,\n"
-"        \"guide\" : \"type: roundrobin, knockout, swiss; event, site for PGN tags; shuffle: random players for roundrobin or swiss\",\n"
+"        \"guide\" : \"type: roundrobin, knockout, swiss; event, site for PGN tags; shuffle: random players for roundrobin or swiss; concurrency: zero for as many games as the computer cores can support; core pinning: each game uses its own cores (threads x 2 if ponder), Linux only; adaptive concurrency: change the number of games between concurrency min and max (zero for core slots) by time losses, engine speeds and computer load; prestart games: number of next games whose engines are started before slots are free (zero for off); max engine launches: engines loaded at the same time; memory budget: keep engines (hash from 'override options' plus their measured memory) within computer memory except 'memory reserve' (MB); memory policy: hash (scale hash down to 'memory min hash' first) or concurrency (reduce games first); match order: listed or longest first (start the matches expected to take longest, by engine stats and time control, first to shorten rounds)\",\n"
 "        \"ponder\" : false,\n"
 "        \"resumable\" : true,\n"
 "        \"shuffle players\" : false,\n"
@@ -49,7 +73,9 @@ static const std::string jsonTourString =
 "    },\n"
 "    \"engine configurations\" :\n"
 "    {\n"
+"        \"guide\" : \"trusted profiles: engines whose files are unchanged since probed by the JSON maker (kept in the engine configuration file name + .cache) start with a short handshake, without parsing their option lists again\",\n"
 "        \"path\" : \"\",\n"
+"        \"trusted profiles\" : false,\n"
 "        \"update\" : false\n"
 "    },\n"
 "    \"inclusive players\" :\n"
@@ -64,12 +90,13 @@ static const std::string jsonTourString =
 "        \"engine\" :\n"
 "        {\n"
 "            \"game title surfix\" : true,\n"
-"            \"guide\" : \"one file: if false, games are stored in multi files using game indexes as surfix; game title surfix: use players names, results for file name surfix, affective only when 'one file' is false; separate by sides: each side has different logs\",\n"
+"            \"guide\" : \"one file: if false, games are stored in multi files using game indexes as surfix; game title surfix: use players names, results for file name surfix, affective only when 'one file' is false; separate by sides: each side has different logs; verbosity: all, normal (drop progress lines such as currmove, nps), compact (also drop info strings, keep the last search line of each depth), minimal (no thinking output)\",\n"
 "            \"mode\" : true,\n"
 "            \"one file\" : false,\n"
 "            \"path\" : \"logengine.txt\",\n"
 "            \"separate by sides\" : false,\n"
-"            \"show time\" : true\n"
+"            \"show time\" : true,\n"
+"            \"verbosity\" : \"all\"\n"
 "        },\n"
 "        \"pgn\" :\n"
 "        {\n"
@@ -118,17 +145,35 @@ static const std::string jsonTourString =
 "            }\n"
 "        ]\n"
 "    },\n"
+"    \"distributed\" :\n"
+"    {\n"
+"        \"guide\" : \"mode: none, coordinator, worker; coordinator hands out matches and collects results, playing no games itself; workers connect to coordinator host and port, play with their own engine configurations, take batch matches at a time and reconnect when connections are lost; unfinished matches of lost workers are re-issued; bind: address the coordinator listens on, 127.0.0.1 for this computer only, 0.0.0.0 for all networks; token: shared secret all messages must carry, required when bind is not a loopback address\",\n"
+"        \"mode\" : \"none\",\n"
+"        \"host\" : \"127.0.0.1\",\n"
+"        \"port\" : 16161,\n"
+"        \"bind\" : \"127.0.0.1\",\n"
+"        \"token\" : \"\",\n"
+"        \"batch\" : 2,\n"
+"        \"worker name\" : \"\"\n"
+"    },\n"
 "    \"endgames\" : {\n"
-"        \"guide\" : \"syzygypath used for both 'override options' and 'game adjudication'\",\n"
+"        \"guide\" : \"syzygypath used for both 'override options' and 'game adjudication'; lazy loading: tablebase files are opened only when games reach their endgames\",\n"
+"        \"lazy loading\" : false,\n"
 "        \"syzygypath\" : \"\"\n"
 "    },\n"
 "    \"game adjudication\" :\n"
 "    {\n"
 "        \"mode\" : true,\n"
-"        \"guide\" : \"finish and adjudicate result; set game length zero to turn it off; tablebase path is from endgames\",\n"
+"        \"guide\" : \"finish and adjudicate result; set game length zero to turn it off; tablebase path is from endgames; scores in centipawns, from engines' views: a side resigns after its scores are under -'resign score' for 'resign move count' moves (and its opponent's are over it if both engines agree); draw after both sides' scores are within 'draw score' for 'draw move count' moves, from 'draw start ply'; set move counts zero to turn them off\",\n"
 "        \"draw if game length over\" : 500,\n"
 "        \"tablebase max pieces\" : 7,\n"
-"        \"tablebase\" : true\n"
+"        \"tablebase\" : true,\n"
+"        \"resign score\" : 1000,\n"
+"        \"resign move count\" : 0,\n"
+"        \"resign both engines agree\" : true,\n"
+"        \"draw score\" : 5,\n"
+"        \"draw move count\" : 0,\n"
+"        \"draw start ply\" : 80\n"
 "    },\n"
 "    \"override options\" :\n"
 "    {\n"
@@ -172,6 +217,15 @@ static const std::string jsonTourString =
 "        \"crafty\",\n"
 "        \"gaviota-1.0\"\n"
 "    ],    \n"
+"    \"sprt\" :\n"
+"    {\n"
+"        \"guide\" : \"sequential probability ratio test for two players of a round robin, the first one is tested; games are paired by openings with swapped sides (pentanomial statistics); the tournament stops when H0 (elo <= elo0) or H1 (elo >= elo1) is accepted with error rates alpha, beta; 'games per pair' is the maximum\",\n"
+"        \"mode\" : false,\n"
+"        \"elo0\" : 0,\n"
+"        \"elo1\" : 5,\n"
+"        \"alpha\" : 0.05,\n"
+"        \"beta\" : 0.05\n"
+"    },\n"
 "    \"time control\" :\n"
 "    {\n"
 "        \"guide\" : \"unit's second; time: could be a real number (e.g. 6.5 for 6.5s) or a string (e.g. '2:10:30' for 2h 20m 30s); mode: standard, infinite, depth, movetime; margin: an extra delay time before checking if time's over\",\n"
@@ -231,8 +285,44 @@ void JsonMaker::tickWork()
         delete e;
     }
     
-    // kick start one each time, not all at one
-    if (!configVec.empty() && workingEngineVec.size() < concurrency) {
+    startProbes();
+    
+    // Completed
+    if (configVec.empty() && workingEngineVec.empty()) {
+        completed();
+    }
+}
+
+void JsonMaker::notifyEvent()
+{
+    // one pending event is enough, it checks all probes
+    if (!eventPending.exchange(true)) {
+        timer.add(std::chrono::milliseconds(0), [=](CppTime::timer_id) { processEvents(); });
+    }
+}
+
+void JsonMaker::processEvents()
+{
+    eventPending = false;
+    if (state != JsonMakerState::working) {
+        return;
+    }
+    
+    // finished probes are deleted by tickWork when their processes are gone
+    for(auto && e : workingEngineVec) {
+        e->checkProgress();
+    }
+    
+    startProbes();
+}
+
+void JsonMaker::startProbes()
+{
+    auto workingCnt = std::count_if(workingEngineVec.begin(), workingEngineVec.end(), [](const JsonEngine* e) {
+        return !e->isFinished();
+    });
+    
+    for(; !configVec.empty() && workingCnt < concurrency; workingCnt++) {
         tick_idle = 0;
         auto config = configVec.back();
         configVec.pop_back();
@@ -240,6 +330,7 @@ void JsonMaker::tickWork()
         auto jsonEngine = new JsonEngine(config);
         workingEngineVec.push_back(jsonEngine);
         
+        jsonEngine->setEventNotifier([=]() { notifyEvent(); });
         jsonEngine->kickStart([=](Config* rConfig) {
             tick_idle = 0;
             
@@ -257,13 +348,9 @@ void JsonMaker::tickWork()
             } else {
                 std::cout << "  not an engine: " << config.command << std::endl;
             }
+            probeCache.update(config.command, rConfig);
         });
     }
-    
-    // Completed
-    if (configVec.empty() && workingEngineVec.empty()) {
-        completed();
-    }
 }
 
 //auto jsonPath = "/Users/nguyenpham/workspace/BanksiaMatch/test.json";
@@ -274,6 +361,8 @@ void JsonMaker::completed()
     
     std::cout << "All engines / executable files are checked, finishing! Total engines: " << goodConfigVec.size() << std::endl;
     
+    probeCache.saveToJsonFile();
+    
     std::sort(goodConfigVec.begin(), goodConfigVec.end(), [](const Config& l, const Config& r)
               {
                   auto lname = l.name, rname = r.name;
@@ -405,7 +494,28 @@ void JsonMaker::build(const std::string& mainJsonPath, const std::string& mainEn
         }
     }
     
-    std::cout << " executable file number: " << configVec.size() << ", concurrency: " << concurrency << std::endl << std::endl;
+    // unchanged files are not probed again
+    probeCache.setJsonPath(jsonEngineConfigPath + ".cache");
+    probeCache.loadFromJsonFile(probeCache.getJsonPath(), false);
+    
+    std::vector<Config> probeVec;
+    for(auto && config : configVec) {
+        auto isEngine = false;
+        Config cachedConfig;
+        if (!probeCache.lookup(config.command, isEngine, cachedConfig)) {
+            probeVec.push_back(config);
+            continue;
+        }
+        if (isEngine) {
+            // configs from the engine configuration file may have been edited, keep them
+            goodConfigVec.push_back(config.protocol == Protocol::none ? cachedConfig : config);
+        }
+    }
+    configVec.swap(probeVec);
+    
+    std::cout << " executable file number: " << configVec.size() + probeCache.getHitCnt()
+    << ", cached: " << probeCache.getHitCnt()
+    << ", concurrency: " << concurrency << std::endl << std::endl;
     
     state = JsonMakerState::working;
     
@@ -436,30 +546,214 @@ static const std::set<std::string>exclusiveFileNameSet {
     "makefile", "readme", "license",
 };
 
-bool JsonMaker::isRunable(const std::string& path)
+static bool isRunableName(std::string fileName)
 {
-    if (!isExecutable(path)) return false;
-    
-    auto p = path.rfind(".");
-    if (p != std::string::npos && path.size() - p <= 5) {
-        auto extString = path.substr(p + 1);
-        toLower(extString);
+    toLower(fileName);
+    auto p = fileName.rfind(".");
+    if (p != std::string::npos && fileName.size() - p <= 5) {
+        auto extString = fileName.substr(p + 1);
         if (extSet.find(extString) != extSet.end()) {
             return false;
         }
     }
     
-    auto fileName = getFileName(path);
-    toLower(fileName);
     return exclusiveFileNameSet.find(fileName) == exclusiveFileNameSet.end();
 }
 
+// Only real binaries (ELF, Mach-O) and scripts with a shebang are worth probing,
+// any other file would burn the whole probe timeout
+static bool hasExecutableHeader(int dirfd, const char* name)
+{
+    auto fd = openat(dirfd, name, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return false;
+    }
+    
+    unsigned char buf[4];
+    auto n = read(fd, buf, sizeof(buf));
+    close(fd);
+    
+    if (n >= 2 && buf[0] == '#' && buf[1] == '!') {
+        return true;
+    }
+    if (n < 4) {
+        return false;
+    }
+    
+    static const unsigned char magics[][4] = {
+        { 0x7f, 'E', 'L', 'F' },
+        { 0xfe, 0xed, 0xfa, 0xce }, { 0xce, 0xfa, 0xed, 0xfe },
+        { 0xfe, 0xed, 0xfa, 0xcf }, { 0xcf, 0xfa, 0xed, 0xfe },
+        { 0xca, 0xfe, 0xba, 0xbe }  // Mach-O universal
+    };
+    for(auto && magic : magics) {
+        if (memcmp(buf, magic, sizeof(buf)) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool JsonMaker::isRunable(const std::string& path)
+{
+    return isExecutable(path) && isRunableName(getFileName(path)) && hasExecutableHeader(AT_FDCWD, path.c_str());
+}
+
+// Walk a folder tree with a few threads, each directory is a task. Files and
+// directories are identified by inodes thus symlinked duplicates count once
+class ExecutableWalker
+{
+public:
+    std::vector<std::string> walk(std::string root)
+    {
+        while (root.size() > 1 && root.back() == '/') {
+            root.pop_back();
+        }
+        
+        struct stat st;
+        if (stat(root.c_str(), &st) != 0 || !S_ISDIR(st.st_mode)) {
+            return std::vector<std::string>();
+        }
+        dirSet.insert(std::make_pair(st.st_dev, st.st_ino));
+        dirQueue.push_back(root);
+        
+        auto threadCnt = std::max(1, std::min(8, getNumberOfCores()));
+        std::vector<std::thread> threads;
+        for(int i = 0; i < threadCnt; i++) {
+            threads.push_back(std::thread(&ExecutableWalker::work, this));
+        }
+        for(auto && t : threads) {
+            t.join();
+        }
+        
+        // prefer real paths to symlinks, then the alphabet order
+        std::sort(foundVec.begin(), foundVec.end(), [](const Found& lhs, const Found& rhs) {
+            return lhs.link != rhs.link ? rhs.link : lhs.path < rhs.path;
+        });
+        
+        std::set<std::pair<dev_t, ino_t>> fileSet;
+        std::vector<std::string> vec;
+        for(auto && f : foundVec) {
+            if (fileSet.insert(std::make_pair(f.dev, f.ino)).second) {
+                vec.push_back(f.path);
+            }
+        }
+        std::sort(vec.begin(), vec.end());
+        return vec;
+    }
+    
+private:
+    struct Found {
+        dev_t dev;
+        ino_t ino;
+        bool link;
+        std::string path;
+    };
+    
+    void work()
+    {
+        for(;;) {
+            std::string dirname;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                cv.wait(lock, [&] { return !dirQueue.empty() || busyCnt == 0; });
+                if (dirQueue.empty()) {
+                    return;
+                }
+                dirname = dirQueue.front();
+                dirQueue.pop_front();
+                busyCnt++;
+            }
+            
+            scan(dirname);
+            
+            std::lock_guard<std::mutex> lock(mutex);
+            if (--busyCnt == 0 && dirQueue.empty()) {
+                cv.notify_all();
+            }
+        }
+    }
+    
+    void scan(const std::string& dirname)
+    {
+        auto dirfd = open(dirname.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+        if (dirfd < 0) {
+            return;
+        }
+        auto d = fdopendir(dirfd);
+        if (!d) {
+            close(dirfd);
+            return;
+        }
+        
+        std::vector<std::pair<std::pair<dev_t, ino_t>, std::string>> subdirVec;
+        std::vector<Found> vec;
+        
+        struct dirent* entry;
+        while ((entry = readdir(d)) != nullptr) {
+            // hidden files, the current and the parent directories
+            if (entry->d_name[0] == '.') {
+                continue;
+            }
+            
+            // follow symlinks
+            struct stat st;
+            if (fstatat(dirfd, entry->d_name, &st, 0) != 0) {
+                continue;
+            }
+            
+            auto path = dirname + "/" + entry->d_name;
+            if (S_ISDIR(st.st_mode)) {
+                subdirVec.push_back(std::make_pair(std::make_pair(st.st_dev, st.st_ino), path));
+                continue;
+            }
+            
+            if (!S_ISREG(st.st_mode)
+                || faccessat(dirfd, entry->d_name, X_OK, 0) != 0
+                || !isRunableName(entry->d_name)
+                || !hasExecutableHeader(dirfd, entry->d_name)) {
+                continue;
+            }
+            
+            Found f;
+            f.dev = st.st_dev;
+            f.ino = st.st_ino;
+            f.link = entry->d_type == DT_LNK;
+            if (entry->d_type == DT_UNKNOWN) {
+                struct stat lst;
+                f.link = fstatat(dirfd, entry->d_name, &lst, AT_SYMLINK_NOFOLLOW) == 0 && S_ISLNK(lst.st_mode);
+            }
+            f.path = path;
+            vec.push_back(f);
+        }
+        closedir(d);
+        
+        std::lock_guard<std::mutex> lock(mutex);
+        foundVec.insert(foundVec.end(), vec.begin(), vec.end());
+        for(auto && p : subdirVec) {
+            // symlinked directories may make loops
+            if (dirSet.insert(p.first).second) {
+                dirQueue.push_back(p.second);
+                cv.notify_one();
+            }
+        }
+    }
+    
+    std::mutex mutex;
+    std::condition_variable cv;
+    std::deque<std::string> dirQueue;
+    int busyCnt = 0;
+    std::set<std::pair<dev_t, ino_t>> dirSet;
+    std::vector<Found> foundVec;
+};
+
 #endif
 
 std::vector<std::string> JsonMaker::listExcecutablePaths(const std::string& dirname)
 {
-    
     auto fullpath = getFullPath(dirname.c_str());
+    
+#ifdef _WIN32
     auto vec = listdir(fullpath);
     
     std::vector<std::string> v;
@@ -469,6 +763,10 @@ std::vector<std::string> JsonMaker::listExcecutablePaths(const std::string& dirn
         }
     }
     return v;
+#else
+    ExecutableWalker walker;
+    return walker.walk(fullpath);
+#endif
 }
 
 
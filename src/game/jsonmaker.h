@@ -27,9 +27,11 @@
 #define jsonmaker_h
 
 #include <stdio.h>
+#include <atomic>
 
 #include "tourmng.h"
 #include "jsonengine.h"
+#include "probecache.h"
 
 namespace banksia {
     
@@ -61,6 +63,11 @@ namespace banksia {
         virtual void tickWork() override;
         void completed();
         
+        // probes report their progress by events, handled on the timer thread
+        void notifyEvent();
+        void processEvents();
+        void startProbes();
+        
     private:
         JsonMakerState state = JsonMakerState::begin;
         
@@ -69,7 +76,9 @@ namespace banksia {
         std::vector<Config> configVec;
         
         std::vector<JsonEngine*> workingEngineVec;
+        std::atomic<bool> eventPending { false };
         std::vector<Config> goodConfigVec;
+        ProbeCache probeCache;
 
         CppTime::Timer timer;
         CppTime::timer_id mainTimerId;
@@ -0,0 +1,156 @@
+/*
+ This file is part of Banksia.
+ 
+ Copyright (c) 2019 Nguyen Hong Pham
+ 
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+ 
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+ 
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+ */
+
+
+#include <sstream>
+#include <cctype>
+#include <cstdlib>
+
+#include "logfilter.h"
+
+using namespace banksia;
+
+std::mutex EngineLogFilter::statsMutex;
+std::map<std::string, std::pair<i64, i64>> EngineLogFilter::statsMap;
+
+static const char* verbosityNames[] = {
+    "all", "normal", "compact", "minimal"
+};
+
+LogVerbosity EngineLogFilter::string2Verbosity(const std::string& name)
+{
+    for(int i = 0; i < 4; i++) {
+        if (name == verbosityNames[i]) {
+            return static_cast<LogVerbosity>(i);
+        }
+    }
+    return LogVerbosity::all;
+}
+
+std::string EngineLogFilter::verbosity2String(LogVerbosity v)
+{
+    return verbosityNames[static_cast<int>(v)];
+}
+
+bool EngineLogFilter::pass(const std::string& line, std::string& releasedLine)
+{
+    releasedLine.clear();
+    auto held = false;
+    if (verbosity == LogVerbosity::all || isWanted(line, held, releasedLine)) {
+        return true;
+    }
+    if (!held) {
+        suppress(line);
+    }
+    return false;
+}
+
+void EngineLogFilter::suppress(const std::string& line)
+{
+    lineCnt++;
+    byteCnt += line.size() + 1;
+}
+
+bool EngineLogFilter::isWanted(const std::string& line, bool& held, std::string& releasedLine)
+{
+    auto depth = -1;
+    auto progress = false, infoString = false;
+    
+    if (line.compare(0, 5, "info ") == 0) {
+        infoString = line.compare(5, 6, "string") == 0;
+        if (!infoString) {
+            // lines without a pv are progress updates: currmove, nps, hashfull...
+            progress = line.find(" pv ") == std::string::npos
+                        || line.find(" lowerbound") != std::string::npos
+                        || line.find(" upperbound") != std::string::npos;
+            auto p = line.find(" depth ");
+            if (p != std::string::npos) {
+                depth = std::atoi(line.c_str() + p + 7);
+            }
+        }
+    } else if (std::isdigit(static_cast<unsigned char>(line[0]))) {
+        // Winboard thinking output starts with the depth
+        depth = std::atoi(line.c_str());
+    } else if (line.compare(0, 6, "stat01") == 0) {
+        progress = true;
+    } else {
+        // commands, moves, results... end the search, its held line goes first.
+        // A new search may start after them
+        releasedLine.swap(heldLine);
+        lastDepth = -1;
+        return true;
+    }
+    
+    switch (verbosity) {
+        case LogVerbosity::normal:
+            return !progress;
+            
+        case LogVerbosity::compact:
+            if (progress || infoString) {
+                return false;
+            }
+            // the last line of a depth has its final score and pv, such as
+            // the one engines repeat just before their moves
+            if (depth == lastDepth) {
+                suppress(heldLine);
+            } else {
+                releasedLine.swap(heldLine);
+            }
+            heldLine = line;
+            lastDepth = depth;
+            held = true;
+            return false;
+            
+        default:
+            return false;
+    }
+}
+
+void EngineLogFilter::flush(const std::string& name)
+{
+    auto lines = lineCnt.exchange(0);
+    auto bytes = byteCnt.exchange(0);
+    if (lines == 0) return;
+    
+    std::lock_guard<std::mutex> dolock(statsMutex);
+    auto& p = statsMap[name];
+    p.first += lines;
+    p.second += bytes;
+}
+
+std::string EngineLogFilter::toString()
+{
+    std::lock_guard<std::mutex> dolock(statsMutex);
+    if (statsMap.empty()) {
+        return "";
+    }
+    
+    std::ostringstream stringStream;
+    stringStream << "Engine log suppressed:";
+    for(auto && it : statsMap) {
+        stringStream << std::endl << "  " << it.first << ": lines " << it.second.first
+        << ", " << (it.second.second + 1023) / 1024 << " KB";
+    }
+    return stringStream.str();
+}
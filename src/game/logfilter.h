@@ -0,0 +1,85 @@
+/*
+ This file is part of Banksia.
+ 
+ Copyright (c) 2019 Nguyen Hong Pham
+ 
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+ 
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+ 
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+ */
+
+
+
+
+
+#ifndef logfilter_h
+#define logfilter_h
+
+#include <string>
+#include <map>
+#include <atomic>
+#include <mutex>
+
+#include "../base/comm.h"
+
+namespace banksia {
+    
+    enum class LogVerbosity {
+        all,        // every line
+        normal,     // drop progress lines (currmove, nps, hashfull, bounds)
+        compact,    // also drop info strings, keep the last search line of each depth
+        minimal     // no thinking output at all
+    };
+    
+    // Decides, before any formatting, whether a line from an engine is worth logging.
+    // Suppressed lines are still parsed by the engine, only the logging is skipped
+    class EngineLogFilter
+    {
+    public:
+        void setVerbosity(LogVerbosity v) { verbosity = v; }
+        LogVerbosity getVerbosity() const { return verbosity; }
+        
+        // true if the line should be logged, otherwise it is counted as suppressed.
+        // A line held earlier may be released, it should be logged before the line
+        bool pass(const std::string& line, std::string& releasedLine);
+        
+        // moves counters of the instance to the tournament stats of the engine
+        void flush(const std::string& name);
+        
+        static LogVerbosity string2Verbosity(const std::string& name);
+        static std::string verbosity2String(LogVerbosity v);
+        
+        static std::string toString();
+        
+    private:
+        bool isWanted(const std::string& line, bool& held, std::string& releasedLine);
+        void suppress(const std::string& line);
+        
+        LogVerbosity verbosity = LogVerbosity::all;
+        int lastDepth = -1;
+        // compact: the latest search line of the current depth
+        std::string heldLine;
+        std::atomic<i64> lineCnt { 0 }, byteCnt { 0 };
+        
+        // suppressed lines and bytes by engine names
+        static std::mutex statsMutex;
+        static std::map<std::string, std::pair<i64, i64>> statsMap;
+    };
+    
+} // namespace banksia
+
+#endif /* logfilter_h */
@@ -0,0 +1,249 @@
+/*
+ This file is part of Banksia.
+ 
+ Copyright (c) 2019 Nguyen Hong Pham
+ 
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+ 
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+ 
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+ */
+
+
+#include <fstream>
+#include <climits>
+
+#ifdef _WIN32
+
+#define NOMINMAX
+
+#include <windows.h>
+#include <psapi.h>
+
+#elif defined(__APPLE__)
+
+#include <libproc.h>
+
+#else
+
+#include <unistd.h>
+
+#endif
+
+#include "memorybudget.h"
+
+using namespace banksia;
+
+// used until engines are measured
+static const int defaultEngineBase = 32;
+
+static i64 floorPowerOfTwo(i64 n)
+{
+    if (n <= 0) {
+        return 0;
+    }
+    i64 k = 1;
+    while (k * 2 <= n) {
+        k *= 2;
+    }
+    return k;
+}
+
+#if !defined(_WIN32) && !defined(__APPLE__)
+// engines may be started via a shell, their children are counted too
+static i64 getResidentPages(int pid, int depth)
+{
+    // second field: resident pages
+    std::ifstream file("/proc/" + std::to_string(pid) + "/statm");
+    i64 size = 0, resident = -1;
+    if (!(file >> size >> resident) || resident < 0) {
+        return -1;
+    }
+    
+    std::ifstream childrenFile("/proc/" + std::to_string(pid) + "/task/" + std::to_string(pid) + "/children");
+    for(int child; depth < 4 && childrenFile >> child; ) {
+        resident += std::max<i64>(0, getResidentPages(child, depth + 1));
+    }
+    return resident;
+}
+#endif
+
+bool MemoryBudget::isValid() const
+{
+    return reserve >= 0 && minHash > 0;
+}
+
+std::string MemoryBudget::toString() const
+{
+    std::ostringstream stringStream;
+    stringStream << "Memory: ";
+    if (!enabled || systemMemory <= 0) {
+        stringStream << "budget off";
+        return stringStream.str();
+    }
+    
+    stringStream << "system " << systemMemory << " MB, reserve " << reserve << " MB, committed " << committed << " of " << budget << " MB, engine base " << getEngineBase() << " MB";
+    if (configuredHash > 0) {
+        stringStream << ", hash " << hash << " MB";
+        if (hash != configuredHash) {
+            stringStream << " (configured " << configuredHash << ")";
+        }
+    }
+    stringStream << ", concurrency cap " << concurrencyCap << ", changes: " << changeCnt;
+    if (!lastChange.empty()) {
+        stringStream << ", last: " << lastChange;
+    }
+    return stringStream.str();
+}
+
+MemoryPolicy MemoryBudget::stringToPolicy(const std::string& name)
+{
+    return name == "concurrency" ? MemoryPolicy::concurrency : MemoryPolicy::hash;
+}
+
+void MemoryBudget::setup(bool _enabled, int _reserve, MemoryPolicy _policy, int _minHash)
+{
+    enabled = _enabled;
+    reserve = std::max(0, _reserve);
+    policy = _policy;
+    minHash = std::max(1, _minHash);
+    concurrencyCap = INT_MAX;
+    systemMemory = i64(getMemorySize() / (1024 * 1024));
+}
+
+void MemoryBudget::setConfiguredHash(int _hash)
+{
+    hash = configuredHash = std::max(0, _hash);
+}
+
+int MemoryBudget::getEngineBase() const
+{
+    if (baseMap.empty()) {
+        return defaultEngineBase;
+    }
+    
+    // the heaviest engine is the one to plan for
+    auto base = 0;
+    for(auto && p : baseMap) {
+        base = std::max(base, p.second);
+    }
+    return base;
+}
+
+bool MemoryBudget::addSample(const std::string& name, int rss, int engineHash)
+{
+    if (!enabled || rss <= 0) {
+        return false;
+    }
+    
+    // engines may not touch all of their hash yet
+    auto base = std::max(1, rss - engineHash);
+    auto it = baseMap.find(name);
+    if (it == baseMap.end()) {
+        baseMap[name] = base;
+        return true;
+    }
+    
+    if (base <= it->second) {
+        return false;
+    }
+    
+    auto notable = base > it->second + std::max(8, it->second / 10);
+    it->second = base;
+    return notable;
+}
+
+bool MemoryBudget::update(int concurrency, int standbyGames)
+{
+    if (!enabled || systemMemory <= 0) {
+        return false;
+    }
+    
+    concurrency = std::max(1, concurrency);
+    standbyGames = std::max(0, standbyGames);
+    budget = std::max<i64>(systemMemory / 4, systemMemory - reserve);
+    
+    i64 base = getEngineBase();
+    auto engineCnt = [=](i64 games) { return (games + standbyGames) * 2; };
+    
+    i64 newHash = configuredHash;
+    if (policy == MemoryPolicy::hash && configuredHash > 0) {
+        auto fit = budget / engineCnt(concurrency) - base;
+        if (fit < configuredHash) {
+            newHash = std::max<i64>(minHash, floorPowerOfTwo(fit));
+        }
+    }
+    
+    i64 newCap = std::max<i64>(1, budget / ((newHash + base) * 2) - standbyGames);
+    
+    // a single game still does not fit
+    if (configuredHash > 0 && engineCnt(newCap) * (newHash + base) > budget) {
+        newHash = std::max<i64>(1, floorPowerOfTwo(budget / engineCnt(newCap) - base));
+    }
+    
+    committed = engineCnt(std::min<i64>(concurrency, newCap)) * (newHash + base);
+    
+    std::ostringstream stringStream;
+    if (newHash != hash) {
+        stringStream << "hash " << hash << " -> " << newHash << " MB";
+    }
+    // the cap is reported only when it limits the games
+    auto oldLimit = std::min<i64>(concurrency, concurrencyCap), newLimit = std::min<i64>(concurrency, newCap);
+    if (oldLimit != newLimit) {
+        if (stringStream.tellp() > 0) stringStream << ", ";
+        stringStream << "concurrency " << oldLimit << " -> " << newLimit;
+    }
+    
+    hash = int(newHash);
+    concurrencyCap = int(std::min<i64>(INT_MAX, newCap));
+    
+    if (stringStream.tellp() <= 0) {
+        return false;
+    }
+    
+    lastChange = stringStream.str();
+    changeCnt++;
+    return true;
+}
+
+int MemoryBudget::getProcessMemory(int pid)
+{
+    if (pid <= 0) {
+        return -1;
+    }
+    
+#ifdef _WIN32
+    auto hProcess = OpenProcess(PROCESS_QUERY_INFORMATION | PROCESS_VM_READ, FALSE, pid);
+    if (hProcess == nullptr) {
+        return -1;
+    }
+    PROCESS_MEMORY_COUNTERS pmc;
+    auto ok = GetProcessMemoryInfo(hProcess, &pmc, sizeof(pmc));
+    CloseHandle(hProcess);
+    return ok ? int(pmc.WorkingSetSize / (1024 * 1024)) : -1;
+    
+#elif defined(__APPLE__)
+    struct proc_taskinfo info;
+    if (proc_pidinfo(pid, PROC_PIDTASKINFO, 0, &info, sizeof(info)) != int(sizeof(info))) {
+        return -1;
+    }
+    return int(info.pti_resident_size / (1024 * 1024));
+    
+#else
+    auto resident = getResidentPages(pid, 0);
+    return resident < 0 ? -1 : int(resident * sysconf(_SC_PAGESIZE) / (1024 * 1024));
+#endif
+}
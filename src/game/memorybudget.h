@@ -0,0 +1,90 @@
+/*
+ This file is part of Banksia.
+ 
+ Copyright (c) 2019 Nguyen Hong Pham
+ 
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+ 
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+ 
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+ */
+
+
+
+#ifndef memorybudget_h
+#define memorybudget_h
+
+#include <map>
+
+#include "../base/comm.h"
+
+namespace banksia {
+    
+    enum class MemoryPolicy {
+        hash, concurrency
+    };
+    
+    // Keeps engines of all concurrent games within the computer memory. The committed
+    // memory is hash plus base memory (measured RSS without hash) of every running
+    // engine. Over the budget, hash is scaled down or concurrency is capped
+    class MemoryBudget : public Obj
+    {
+    public:
+        virtual const char* className() const override { return "MemoryBudget"; }
+        virtual bool isValid() const override;
+        virtual std::string toString() const override;
+        
+        static MemoryPolicy stringToPolicy(const std::string& name);
+        
+        // sizes in MB
+        void setup(bool enabled, int reserve, MemoryPolicy policy, int minHash);
+        
+        // zero if engines' hash is not overridden
+        void setConfiguredHash(int hash);
+        
+        bool isEnabled() const { return enabled; }
+        
+        // a running engine, return true if its base memory grows notably
+        bool addSample(const std::string& name, int rss, int engineHash);
+        
+        // return true if the hash or the concurrency cap has been changed
+        bool update(int concurrency, int standbyGames);
+        
+        int getHash() const { return hash; }
+        int getConcurrencyCap() const { return concurrencyCap; }
+        const std::string& getLastChange() const { return lastChange; }
+        
+        // resident memory of a process in MB, negative if unknown
+        static int getProcessMemory(int pid);
+        
+    private:
+        int getEngineBase() const;
+        
+        bool enabled = false;
+        MemoryPolicy policy = MemoryPolicy::hash;
+        int reserve = 0, configuredHash = 0, minHash = 1;
+        
+        int hash = 0, concurrencyCap = 0;
+        i64 systemMemory = 0, budget = 0, committed = 0;
+        
+        std::map<std::string, int> baseMap;
+        int changeCnt = 0;
+        std::string lastChange;
+    };
+    
+} // namespace banksia
+
+#endif /* memorybudget_h */
@@ -0,0 +1,115 @@
+/*
+ This file is part of Banksia.
+ 
+ Copyright (c) 2019 Nguyen Hong Pham
+ 
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+ 
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+ 
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+ */
+
+
+#include <sstream>
+#include <thread>
+
+#include "outputqueue.h"
+
+using namespace banksia;
+
+std::atomic<i64> OutputQueue::lineCnt(0), OutputQueue::maxDepth(0), OutputQueue::longestStall(0), OutputQueue::fullWaitCnt(0);
+
+OutputQueue::OutputQueue(size_t capacity)
+: ring(capacity)
+{
+}
+
+i64 OutputQueue::now()
+{
+    return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void OutputQueue::push(std::string& line)
+{
+    auto t = tail.load(std::memory_order_relaxed);
+    
+    // full, the engine is flooding, give the consumer a moment instead of dropping lines
+    while (t - head.load(std::memory_order_acquire) >= ring.size()) {
+        fullWaitCnt++;
+        notify();
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    
+    auto& item = ring[t % ring.size()];
+    item.line.swap(line);
+    item.stamp = now();
+    tail.store(t + 1, std::memory_order_release);
+    
+    auto depth = i64(t + 1 - head.load(std::memory_order_acquire));
+    for(auto m = maxDepth.load(); depth > m && !maxDepth.compare_exchange_weak(m, depth);) {}
+}
+
+void OutputQueue::finish()
+{
+    finished = true;
+    notify();
+}
+
+void OutputQueue::notify()
+{
+    {
+        std::lock_guard<std::mutex> dolock(waitMutex);
+    }
+    waitCond.notify_one();
+}
+
+bool OutputQueue::pop(std::string& line)
+{
+    auto h = head.load(std::memory_order_relaxed);
+    if (h == tail.load(std::memory_order_acquire)) {
+        return false;
+    }
+    
+    auto& item = ring[h % ring.size()];
+    line.swap(item.line);
+    item.line.clear();
+    
+    auto stall = now() - item.stamp;
+    for(auto m = longestStall.load(); stall > m && !longestStall.compare_exchange_weak(m, stall);) {}
+    lineCnt++;
+    
+    head.store(h + 1, std::memory_order_release);
+    return true;
+}
+
+void OutputQueue::wait(int ms)
+{
+    std::unique_lock<std::mutex> lock(waitMutex);
+    waitCond.wait_for(lock, std::chrono::milliseconds(ms), [this] {
+        return head.load(std::memory_order_relaxed) != tail.load(std::memory_order_acquire);
+    });
+}
+
+std::string OutputQueue::toString()
+{
+    std::ostringstream stringStream;
+    stringStream << "Engine output: lines " << lineCnt << ", max queue " << maxDepth
+    << ", longest stall " << longestStall << " ms";
+    if (fullWaitCnt) {
+        stringStream << ", full waits " << fullWaitCnt;
+    }
+    return stringStream.str();
+}
@@ -0,0 +1,86 @@
+/*
+ This file is part of Banksia.
+ 
+ Copyright (c) 2019 Nguyen Hong Pham
+ 
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+ 
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+ 
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+ */
+
+
+
+
+#ifndef outputqueue_h
+#define outputqueue_h
+
+#include <string>
+#include <vector>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+
+#include "../base/comm.h"
+
+namespace banksia {
+    
+    // Lines from an engine, queued by the pipe reader thread (the only producer)
+    // and parsed by the engine thread (the only consumer), so slow logging or
+    // game locks never keep the pipe from being drained
+    class OutputQueue
+    {
+    public:
+        OutputQueue(size_t capacity = 4 * 1024);
+        
+        // producer
+        void push(std::string& line);
+        void notify();
+        
+        // producer, no more lines
+        void finish();
+        
+        // consumer, waits for lines up to a given period
+        bool pop(std::string& line);
+        void wait(int ms);
+        bool isFinished() const { return finished; }
+        
+        static std::string toString();
+        static i64 getLineCnt() { return lineCnt; }
+        
+    private:
+        struct Item {
+            std::string line;
+            i64 stamp;
+        };
+        
+        static i64 now();
+        
+        std::vector<Item> ring;
+        std::atomic<size_t> head { 0 }, tail { 0 };
+        std::atomic<bool> finished { false };
+        
+        std::mutex waitMutex;
+        std::condition_variable waitCond;
+        
+        // stats of all engines
+        static std::atomic<i64> lineCnt, maxDepth, longestStall, fullWaitCnt;
+    };
+    
+} // namespace banksia
+
+#endif /* outputqueue_h */
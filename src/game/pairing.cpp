@@ -0,0 +1,170 @@
+/*
+ This file is part of Banksia.
+ 
+ Copyright (c) 2019 Nguyen Hong Pham
+ 
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+ 
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+ 
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+ */
+
+
+#include <queue>
+
+#include "pairing.h"
+
+using namespace banksia;
+
+PlayerPairing::PlayerPairing(int _playerCnt)
+: playerCnt(_playerCnt)
+{
+    metBits.resize(playerCnt, std::vector<u64>((playerCnt + 63) / 64, 0));
+}
+
+void PlayerPairing::setMet(int a, int b)
+{
+    if (a < 0 || b < 0 || a >= playerCnt || b >= playerCnt) {
+        return;
+    }
+    metBits[a][b >> 6] |= u64(1) << (b & 63);
+    metBits[b][a >> 6] |= u64(1) << (a & 63);
+}
+
+bool PlayerPairing::hasMet(int a, int b) const
+{
+    return (metBits[a][b >> 6] >> (b & 63)) & 1;
+}
+
+bool PlayerPairing::pair(std::vector<std::pair<int, int>>& pairVec)
+{
+    mate.assign(playerCnt, -1);
+    
+    // the nearest ranked opponents first, players of a score group are paired together
+    for(int i = 0; i < playerCnt; i++) {
+        if (mate[i] >= 0) continue;
+        for(int j = i + 1; j < playerCnt; j++) {
+            if (mate[j] < 0 && canPair(i, j)) {
+                mate[i] = j; mate[j] = i;
+                break;
+            }
+        }
+    }
+    
+    for(int i = 0; i < playerCnt; i++) {
+        if (mate[i] < 0 && !augment(i)) {
+            return false;
+        }
+    }
+    
+    pairVec.clear();
+    for(int i = 0; i < playerCnt; i++) {
+        if (i < mate[i]) {
+            pairVec.push_back(std::make_pair(i, mate[i]));
+        }
+    }
+    return true;
+}
+
+bool PlayerPairing::augment(int root)
+{
+    auto v = findPath(root);
+    if (v < 0) {
+        return false;
+    }
+    
+    // flip the path
+    while (v >= 0) {
+        auto pv = parent[v], ppv = mate[pv];
+        mate[v] = pv; mate[pv] = v;
+        v = ppv;
+    }
+    return true;
+}
+
+int PlayerPairing::findBase(int a, int b)
+{
+    std::vector<bool> onPath(playerCnt, false);
+    for(;;) {
+        a = base[a];
+        onPath[a] = true;
+        if (mate[a] < 0) break;
+        a = parent[mate[a]];
+    }
+    for(;;) {
+        b = base[b];
+        if (onPath[b]) return b;
+        b = parent[mate[b]];
+    }
+}
+
+void PlayerPairing::markPath(int v, int b, int child)
+{
+    while (base[v] != b) {
+        blossom[base[v]] = blossom[base[mate[v]]] = true;
+        parent[v] = child;
+        child = mate[v];
+        v = parent[mate[v]];
+    }
+}
+
+int PlayerPairing::findPath(int root)
+{
+    used.assign(playerCnt, false);
+    parent.assign(playerCnt, -1);
+    base.resize(playerCnt);
+    for(int i = 0; i < playerCnt; i++) {
+        base[i] = i;
+    }
+    
+    used[root] = true;
+    std::queue<int> q;
+    q.push(root);
+    
+    while (!q.empty()) {
+        auto v = q.front(); q.pop();
+        for(int to = 0; to < playerCnt; to++) {
+            if (!canPair(v, to) || base[v] == base[to] || mate[v] == to) {
+                continue;
+            }
+            
+            if (to == root || (mate[to] >= 0 && parent[mate[to]] >= 0)) {
+                // odd cycle: contract the blossom
+                auto curBase = findBase(v, to);
+                blossom.assign(playerCnt, false);
+                markPath(v, curBase, to);
+                markPath(to, curBase, v);
+                for(int i = 0; i < playerCnt; i++) {
+                    if (blossom[base[i]]) {
+                        base[i] = curBase;
+                        if (!used[i]) {
+                            used[i] = true;
+                            q.push(i);
+                        }
+                    }
+                }
+            } else if (parent[to] < 0) {
+                parent[to] = v;
+                if (mate[to] < 0) {
+                    return to;
+                }
+                used[mate[to]] = true;
+                q.push(mate[to]);
+            }
+        }
+    }
+    return -1;
+}
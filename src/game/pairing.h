@@ -0,0 +1,69 @@
+/*
+ This file is part of Banksia.
+ 
+ Copyright (c) 2019 Nguyen Hong Pham
+ 
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+ 
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+ 
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+ */
+
+
+
+#ifndef pairing_h
+#define pairing_h
+
+#include "../base/comm.h"
+
+namespace banksia {
+    
+    // Pairs players of a round, identified by their ranks (0 is the top one), avoiding
+    // opponents they have met. Players are paired greedily with the nearest ranked ones,
+    // then the unpaired ones are fixed by augmenting paths (Edmonds' blossoms), thus
+    // it never backtracks: O(n^2) for most rounds, O(n^3) at worst
+    class PlayerPairing
+    {
+    public:
+        explicit PlayerPairing(int playerCnt);
+        
+        void setMet(int a, int b);
+        bool hasMet(int a, int b) const;
+        
+        // pairs of ranks (the higher ranked first), false if not all players can be paired
+        bool pair(std::vector<std::pair<int, int>>& pairVec);
+        
+    private:
+        bool canPair(int a, int b) const {
+            return a != b && !hasMet(a, b);
+        }
+        
+        bool augment(int root);
+        int findPath(int root);
+        int findBase(int a, int b);
+        void markPath(int v, int b, int child);
+        
+        int playerCnt;
+        std::vector<std::vector<u64>> metBits;
+        
+        // for augmenting paths
+        std::vector<int> mate, parent, base;
+        std::vector<bool> used, blossom;
+    };
+    
+} // namespace banksia
+
+#endif /* pairing_h */
@@ -36,7 +36,7 @@ Player::Player()
 }
 
 Player::Player(const std::string& name, PlayerType type)
-: idNumber(std::rand()), name(name), type(type)
+: idNumber(std::rand()), name(name), type(type), state(PlayerState::none)
 {
 }
 
@@ -91,6 +91,7 @@ bool Player::goPonder(const Move&)
 
 bool Player::go()
 {
+    goTime = std::chrono::system_clock::now();
     setState(PlayerState::playing);
     score = depth = 0; nodes = 0;
     return true;
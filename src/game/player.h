@@ -60,6 +60,11 @@ namespace banksia {
         void setState(PlayerState st);
         int getTickState() const { return tick_state; }
         void setPonderMode(bool mode) { ponderMode = mode; }
+        
+        // kept by an owner other than games (e.g. engines started in advance),
+        // the player manager doesn't delete it when it stops
+        void setHeld(bool mode) { held = mode; }
+        bool isHeld() const { return held; }
 
     public:
         virtual bool kickStart() = 0;
@@ -90,6 +95,11 @@ namespace banksia {
         i64 getNodes() const {
             return nodes;
         }
+        
+        // when the last go command was sent
+        std::chrono::system_clock::time_point getGoTime() const {
+            return goTime;
+        }
 
     protected:
         int idNumber; // a random number, main purpose for debugging
@@ -102,7 +112,8 @@ namespace banksia {
         int score, depth;
         i64 nodes;
         
-        bool ponderMode = false;
+        bool ponderMode = false, held = false;
+        std::chrono::system_clock::time_point goTime;
         
         std::function<void(const Move&, const std::string&, const Move&, double, EngineComputingState)> moveReceiver = nullptr;
         std::function<void()> resignFunc = nullptr;
@@ -48,7 +48,7 @@ void PlayerMng::tickWork()
     
     for(auto && player : playerList) {
         if (player->getState() == PlayerState::stopped) {
-            if (!player->isAttached()) {
+            if (!player->isAttached() && !player->isHeld()) {
                 removingList.push_back(player);
             }
         } else {
@@ -0,0 +1,146 @@
+/*
+ This file is part of Banksia.
+ 
+ Copyright (c) 2019 Nguyen Hong Pham
+ 
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+ 
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+ 
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+ */
+
+
+
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#include "probecache.h"
+
+using namespace banksia;
+
+std::string ProbeCache::toString() const
+{
+    return "probe cache, hits: " + std::to_string(hitCnt) + ", updates: " + std::to_string(updateCnt);
+}
+
+bool ProbeCache::getIdentity(const std::string& path, Entry& entry)
+{
+#ifdef _WIN32
+    struct __stat64 st;
+    if (_stat64(path.c_str(), &st) != 0) {
+        return false;
+    }
+#else
+    struct stat st;
+    if (stat(path.c_str(), &st) != 0) {
+        return false;
+    }
+#endif
+    entry.size = i64(st.st_size);
+    entry.mtime = i64(st.st_mtime);
+    entry.inode = i64(st.st_ino);
+    return true;
+}
+
+bool ProbeCache::lookup(const std::string& command, bool& isEngine, Config& config)
+{
+    auto it = entryMap.find(command);
+    if (it == entryMap.end()) {
+        return false;
+    }
+    
+    Entry entry;
+    if (!getIdentity(command, entry)
+        || entry.size != it->second.size || entry.mtime != it->second.mtime || entry.inode != it->second.inode) {
+        return false;
+    }
+    
+    isEngine = it->second.engine;
+    if (isEngine) {
+        config = it->second.config;
+    }
+    usedSet.insert(command);
+    hitCnt++;
+    return true;
+}
+
+void ProbeCache::update(const std::string& command, const Config* config)
+{
+    Entry entry;
+    if (!getIdentity(command, entry)) {
+        return;
+    }
+    
+    entry.engine = config != nullptr;
+    if (config) {
+        entry.config = *config;
+    }
+    entryMap[command] = entry;
+    usedSet.insert(command);
+    updateCnt++;
+}
+
+bool ProbeCache::parseJsonAfterLoading(Json::Value& jsonData)
+{
+    entryMap.clear();
+    usedSet.clear();
+    
+    for (Json::Value::const_iterator it = jsonData.begin(); it != jsonData.end(); ++it) {
+        auto& obj = *it;
+        auto command = obj["path"].asString();
+        if (command.empty()) {
+            continue;
+        }
+        
+        Entry entry;
+        entry.size = obj["size"].asInt64();
+        entry.mtime = obj["mtime"].asInt64();
+        entry.inode = obj["inode"].asInt64();
+        entry.engine = obj["engine"].asBool();
+        if (entry.engine) {
+            if (!entry.config.load(obj["config"]) || entry.config.protocol == Protocol::none) {
+                continue;
+            }
+            entry.config.idName = obj["id name"].asString();
+        }
+        entryMap[command] = entry;
+    }
+    return true;
+}
+
+Json::Value ProbeCache::createJsonForSaving()
+{
+    Json::Value jsonData(Json::arrayValue);
+    for(auto && p : entryMap) {
+        if (usedSet.find(p.first) == usedSet.end()) {
+            continue;
+        }
+        
+        auto& entry = p.second;
+        Json::Value obj;
+        obj["path"] = p.first;
+        obj["size"] = Json::Int64(entry.size);
+        obj["mtime"] = Json::Int64(entry.mtime);
+        obj["inode"] = Json::Int64(entry.inode);
+        obj["engine"] = entry.engine;
+        if (entry.engine) {
+            obj["config"] = entry.config.saveToJson();
+            obj["id name"] = entry.config.idName;
+        }
+        jsonData.append(obj);
+    }
+    return jsonData;
+}
@@ -0,0 +1,76 @@
+/*
+ This file is part of Banksia.
+ 
+ Copyright (c) 2019 Nguyen Hong Pham
+ 
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+ 
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+ 
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+ */
+
+
+
+#ifndef probecache_h
+#define probecache_h
+
+#include <map>
+#include <set>
+
+#include "configmng.h"
+
+namespace banksia {
+    
+    // Results of probing executables (engine configs or non-engines) kept between
+    // runs of the JSON maker. An entry is valid while its file keeps the same
+    // size, modified time and inode
+    class ProbeCache : public Obj, public JsonSavable
+    {
+    public:
+        virtual const char* className() const override { return "ProbeCache"; }
+        virtual bool isValid() const override { return true; }
+        virtual std::string toString() const override;
+        
+        // true if the file is unchanged since it was probed, config is valid for engines only
+        bool lookup(const std::string& command, bool& isEngine, Config& config);
+        // config is null for a non-engine
+        void update(const std::string& command, const Config* config);
+        
+        int getHitCnt() const { return hitCnt; }
+        
+    protected:
+        virtual bool parseJsonAfterLoading(Json::Value&) override;
+        virtual Json::Value createJsonForSaving() override;
+        
+    private:
+        class Entry {
+        public:
+            i64 size = 0, mtime = 0, inode = 0;
+            bool engine = false;
+            Config config;
+        };
+        
+        static bool getIdentity(const std::string& path, Entry& entry);
+        
+        std::map<std::string, Entry> entryMap;
+        // entries not used by the current run are dropped when saving
+        std::set<std::string> usedSet;
+        int hitCnt = 0, updateCnt = 0;
+    };
+    
+} // namespace banksia
+
+#endif /* probecache_h */
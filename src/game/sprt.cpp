@@ -0,0 +1,170 @@
+/*
+ This file is part of Banksia.
+ 
+ Copyright (c) 2019 Nguyen Hong Pham
+ 
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+ 
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+ 
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+ */
+
+
+#include <cmath>
+
+#include "sprt.h"
+
+using namespace banksia;
+
+static double eloToScore(double elo)
+{
+    return 1.0 / (1.0 + std::pow(10.0, -elo / 400.0));
+}
+
+static double scoreToElo(double score)
+{
+    score = std::min(0.9999, std::max(0.0001, score));
+    return -400.0 * std::log10(1.0 / score - 1.0);
+}
+
+bool Sprt::isValid() const
+{
+    return elo0 < elo1 && alpha > 0 && alpha < 1 && beta > 0 && beta < 1;
+}
+
+std::string Sprt::toString() const
+{
+    std::ostringstream stringStream;
+    stringStream.precision(2);
+    stringStream << std::fixed;
+    
+    double elo, margin;
+    getElo(elo, margin);
+    
+    stringStream << "SPRT: elo0: " << elo0 << ", elo1: " << elo1
+    << ", alpha: " << alpha << ", beta: " << beta
+    << "; LLR: " << getLLR() << " (" << getLowerBound() << ", " << getUpperBound() << ")"
+    << "; pairs: " << getPairCount()
+    << ", pentanomial: [" << penta[0] << ", " << penta[1] << ", " << penta[2] << ", " << penta[3] << ", " << penta[4] << "]"
+    << "; elo: " << elo << " +/- " << margin
+    << "; " << (result == SprtResult::h1 ? "H1 accepted" : result == SprtResult::h0 ? "H0 accepted" : "inconclusive");
+    return stringStream.str();
+}
+
+void Sprt::setup(bool _enabled, double _elo0, double _elo1, double _alpha, double _beta)
+{
+    enabled = _enabled;
+    elo0 = _elo0; elo1 = _elo1;
+    alpha = _alpha; beta = _beta;
+    clear();
+}
+
+void Sprt::clear()
+{
+    result = SprtResult::none;
+    for(auto && n : penta) {
+        n = 0;
+    }
+}
+
+void Sprt::addPair(double score)
+{
+    auto k = int(std::lround(score * 2));
+    if (k >= 0 && k < 5) {
+        penta[k]++;
+    }
+}
+
+int Sprt::getPairCount() const
+{
+    auto n = 0;
+    for(auto && c : penta) {
+        n += c;
+    }
+    return n;
+}
+
+bool Sprt::getMeanVariance(double& mean, double& variance) const
+{
+    mean = variance = 0;
+    auto n = getPairCount();
+    if (n == 0) {
+        return false;
+    }
+    
+    // empty bins get a tiny count, otherwise a few lucky pairs give zero variance
+    double freq[5], total = 0;
+    for(int i = 0; i < 5; i++) {
+        freq[i] = penta[i] > 0 ? penta[i] : 1e-3;
+        total += freq[i];
+    }
+    
+    for(int i = 0; i < 5; i++) {
+        mean += freq[i] / total * (i / 4.0);
+    }
+    for(int i = 0; i < 5; i++) {
+        auto d = i / 4.0 - mean;
+        variance += freq[i] / total * d * d;
+    }
+    return variance > 0;
+}
+
+double Sprt::getLLR() const
+{
+    double mean, variance;
+    if (!getMeanVariance(mean, variance)) {
+        return 0;
+    }
+    
+    auto s0 = eloToScore(elo0), s1 = eloToScore(elo1);
+    return getPairCount() * (s1 - s0) * (2 * mean - s0 - s1) / (2 * variance);
+}
+
+double Sprt::getLowerBound() const
+{
+    return std::log(beta / (1 - alpha));
+}
+
+double Sprt::getUpperBound() const
+{
+    return std::log((1 - beta) / alpha);
+}
+
+SprtResult Sprt::update()
+{
+    if (result == SprtResult::none) {
+        auto llr = getLLR();
+        if (llr >= getUpperBound()) {
+            result = SprtResult::h1;
+        } else if (llr <= getLowerBound()) {
+            result = SprtResult::h0;
+        }
+    }
+    return result;
+}
+
+void Sprt::getElo(double& elo, double& margin) const
+{
+    elo = margin = 0;
+    double mean, variance;
+    if (!getMeanVariance(mean, variance)) {
+        return;
+    }
+    
+    auto d = 1.959964 * std::sqrt(variance / getPairCount());
+    elo = scoreToElo(mean);
+    margin = (scoreToElo(mean + d) - scoreToElo(mean - d)) / 2;
+}
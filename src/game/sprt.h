@@ -0,0 +1,83 @@
+/*
+ This file is part of Banksia.
+ 
+ Copyright (c) 2019 Nguyen Hong Pham
+ 
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+ 
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+ 
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+ */
+
+
+
+#ifndef sprt_h
+#define sprt_h
+
+#include "../base/comm.h"
+
+namespace banksia {
+    
+    enum class SprtResult {
+        none, h0, h1
+    };
+    
+    // Sequential probability ratio test (GSPRT) on game pairs: each opening is played
+    // twice with swapped sides, a pair scores 0, 0.5, 1, 1.5 or 2 for the first player.
+    // Elo bounds are logistic ones, H0: elo <= elo0, H1: elo >= elo1
+    class Sprt : public Obj
+    {
+    public:
+        virtual const char* className() const override { return "Sprt"; }
+        virtual bool isValid() const override;
+        virtual std::string toString() const override;
+        
+        void setup(bool enabled, double elo0, double elo1, double alpha, double beta);
+        bool isEnabled() const { return enabled; }
+        
+        void clear();
+        
+        // score of the first player for both games of a pair, from 0 to 2
+        void addPair(double score);
+        int getPairCount() const;
+        
+        // log-likelihood ratio and its bounds
+        double getLLR() const;
+        double getLowerBound() const;
+        double getUpperBound() const;
+        
+        // the first decision is kept
+        SprtResult update();
+        SprtResult getResult() const { return result; }
+        
+        // elo difference and its 95% error margin
+        void getElo(double& elo, double& margin) const;
+        
+    private:
+        // mean and variance of pair scores, scaled into 0..1
+        bool getMeanVariance(double& mean, double& variance) const;
+        
+        bool enabled = false;
+        SprtResult result = SprtResult::none;
+        double elo0 = 0, elo1 = 5, alpha = 0.05, beta = 0.05;
+        
+        // LL, LD, LW + DD, DW, WW
+        int penta[5] = { 0, 0, 0, 0, 0 };
+    };
+    
+} // namespace banksia
+
+#endif /* sprt_h */
@@ -230,6 +230,13 @@ void GameTimeController::startMoveTimeClock()
     moveStartClock = std::chrono::system_clock::now();
 }
 
+void GameTimeController::startMoveTimeClock(const std::chrono::system_clock::time_point& tp)
+{
+    if (tp > moveStartClock) {
+        moveStartClock = tp;
+    }
+}
+
 // unit: second
 double GameTimeController::moveTimeConsumed() const
 {
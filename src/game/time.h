@@ -84,6 +84,9 @@ namespace banksia {
         double moveTimeConsumed() const;
 
         double getTimeLeft(int sd) const;
+        
+        // restart the move clock at a later time, e.g. when the go command actually reached the engine
+        void startMoveTimeClock(const std::chrono::system_clock::time_point& tp);
 
         double lastQueryConsumed = 0;
         
@@ -30,8 +30,13 @@
 #include <random>
 #include <ctime>
 #include <cmath>
+#include <limits>
+#include <queue>
+#include <unordered_set>
 
 #include "tourmng.h"
+#include "probecache.h"
+#include "pairing.h"
 
 #include "../3rdparty/json/json.h"
 #include "../3rdparty/fathom/tbprobe.h"
@@ -116,6 +121,123 @@ Json::Value MatchRecord::saveToJson() const
     return obj;
 }
 
+void MatchStore::clear()
+{
+    recordList.clear();
+    readyQueue.clear();
+    pairMap.clear();
+    roundMap.clear();
+    memset(stateCnt, 0, sizeof(stateCnt));
+    lastRound = 0;
+}
+
+void MatchStore::assign(const std::vector<MatchRecord>& list)
+{
+    clear();
+    for(auto && r : list) {
+        push_back(r);
+    }
+}
+
+void MatchStore::push_back(const MatchRecord& record)
+{
+    recordList.push_back(record);
+    index(int(recordList.size()) - 1);
+}
+
+void MatchStore::index(int idx)
+{
+    auto& record = recordList[idx];
+    stateCnt[static_cast<int>(record.state)]++;
+    if (record.state == MatchState::none) {
+        readyQueue.push_back(idx);
+        readyStamp++;
+    }
+    pairMap[record.pairId].push_back(idx);
+    roundMap[record.round].push_back(idx);
+    lastRound = std::max(lastRound, record.round);
+}
+
+void MatchStore::setState(int gameIdx, MatchState state)
+{
+    assert(gameIdx >= 0 && gameIdx < int(recordList.size()));
+    auto& record = recordList[gameIdx];
+    if (record.state == state) {
+        return;
+    }
+    stateCnt[static_cast<int>(record.state)]--;
+    stateCnt[static_cast<int>(state)]++;
+    record.state = state;
+    
+    if (state == MatchState::none) {
+        readyQueue.push_back(gameIdx);
+        readyStamp++;
+    }
+}
+
+int MatchStore::popReady()
+{
+    // records may have been changed their states after queued
+    while (!readyQueue.empty()) {
+        auto idx = readyQueue.front();
+        readyQueue.pop_front();
+        if (recordList[idx].state == MatchState::none) {
+            return idx;
+        }
+    }
+    return -1;
+}
+
+std::vector<int> MatchStore::peekReady(int n) const
+{
+    std::vector<int> vec;
+    for(auto && idx : readyQueue) {
+        if (int(vec.size()) >= n) {
+            break;
+        }
+        if (recordList[idx].state == MatchState::none) {
+            vec.push_back(idx);
+        }
+    }
+    return vec;
+}
+
+void MatchStore::sortReady(const std::function<double(int)>& keyFunc)
+{
+    // drop stale and duplicated entries too
+    std::unordered_set<int> queued;
+    queued.reserve(readyQueue.size());
+    std::vector<std::pair<double, int>> vec;
+    for(auto && idx : readyQueue) {
+        if (recordList[idx].state == MatchState::none && queued.insert(idx).second) {
+            vec.push_back(std::make_pair(keyFunc(idx), idx));
+        }
+    }
+    
+    std::stable_sort(vec.begin(), vec.end(), [](const std::pair<double, int>& lhs, const std::pair<double, int>& rhs) {
+        return lhs.first > rhs.first;
+    });
+    
+    readyQueue.clear();
+    for(auto && p : vec) {
+        readyQueue.push_back(p.second);
+    }
+}
+
+const std::vector<int>& MatchStore::getPair(int pairId) const
+{
+    static const std::vector<int> emptyVec;
+    auto it = pairMap.find(pairId);
+    return it != pairMap.end() ? it->second : emptyVec;
+}
+
+const std::vector<int>& MatchStore::getRound(int round) const
+{
+    static const std::vector<int> emptyVec;
+    auto it = roundMap.find(round);
+    return it != roundMap.end() ? it->second : emptyVec;
+}
+
 // https://www.chessprogramming.org/Match_Statistics
 Elo::Elo(int wins, int draws, int losses) {
     elo_difference = los = 0.0;
@@ -178,11 +300,18 @@ bool TourMng::start(const std::string& mainJsonPath, bool yesReply, bool noReply
     
     showTournamentInfo();
     
-    if ((noReply || !loadMatchRecords(yesReply))
+    if (distMode != DistributedMode::worker
+        && (noReply || !loadMatchRecords(yesReply))
         && !createMatchList()) {
         return false;
     }
     
+    if (!startNetwork()) {
+        return false;
+    }
+    
+    initSprt();
+    
     // The app will be terminated when all matches completed
     startTournament();
     return true;
@@ -236,19 +365,61 @@ bool TourMng::parseJsonAfterLoading(Json::Value& d)
             siteName = v[s].asString();
         }
         
+        // zero or missing: as many games as core slots
         s = "concurrency";
-        if (v.isMember(s)) {
-            gameConcurrency = std::max(1, v[s].asInt());
-        }
+        gameConcurrency = v.isMember(s) ? std::max(0, v[s].asInt()) : 0;
+        
+        s = "core pinning";
+        corePinningMode = v.isMember(s) && v[s].asBool();
+        
+        s = "adaptive concurrency";
+        adaptiveConcurrencyMode = v.isMember(s) && v[s].asBool();
+        
+        // zero or missing max: as many games as core slots
+        s = "concurrency min";
+        concurrencyMin = v.isMember(s) ? std::max(1, v[s].asInt()) : 1;
+        s = "concurrency max";
+        concurrencyMax = v.isMember(s) ? std::max(0, v[s].asInt()) : 0;
+        
+        s = "prestart games";
+        prestartGames = v.isMember(s) ? std::max(0, v[s].asInt()) : 0;
+        s = "max engine launches";
+        maxEngineLaunches = v.isMember(s) ? std::max(1, v[s].asInt()) : 2;
+        
+        s = "memory budget";
+        auto memoryBudgetMode = v.isMember(s) && v[s].asBool();
+        s = "memory reserve";
+        auto memoryReserve = v.isMember(s) ? v[s].asInt() : 1024;
+        s = "memory policy";
+        auto memoryPolicy = MemoryBudget::stringToPolicy(v.isMember(s) ? v[s].asString() : "");
+        s = "memory min hash";
+        auto memoryMinHash = v.isMember(s) ? v[s].asInt() : 16;
+        memoryBudget.setup(memoryBudgetMode, memoryReserve, memoryPolicy, memoryMinHash);
+        
+        s = "match order";
+        matchOrder = v.isMember(s) && v[s].asString() == "longest first" ? MatchOrder::longestfirst : MatchOrder::listed;
+    }
+    
+    if (d.isMember("distributed")) {
+        auto v = d["distributed"];
+        auto str = v["mode"].asString();
+        distMode = str == "coordinator" ? DistributedMode::coordinator : str == "worker" ? DistributedMode::worker : DistributedMode::none;
+        if (v.isMember("host")) distHost = v["host"].asString();
+        if (v.isMember("port")) distPort = v["port"].asInt();
+        if (v.isMember("bind")) distBind = v["bind"].asString();
+        if (v.isMember("token")) distToken = v["token"].asString();
+        if (v.isMember("batch")) distBatch = std::max(0, v["batch"].asInt());
+        if (v.isMember("worker name")) workerName = v["worker name"].asString();
     }
     
     // Engine configurations
     std::string enginConfigJsonPath = "./engines.json";
-    bool enginConfigUpdate = false;
+    bool enginConfigUpdate = false, trustedProfiles = false;
     auto s = "engine configurations";
     if (d.isMember(s)) {
         auto v = d[s];
         enginConfigUpdate = v["update"].isBool() && v["update"].asBool();
+        trustedProfiles = v["trusted profiles"].isBool() && v["trusted profiles"].asBool();
         enginConfigJsonPath = v["path"].asString();
     }
     
@@ -257,6 +428,10 @@ bool TourMng::parseJsonAfterLoading(Json::Value& d)
         return false;
     }
     
+    if (trustedProfiles) {
+        markTrustedProfiles(enginConfigJsonPath + ".cache");
+    }
+    
     s = "override options";
     if (d.isMember(s)) {
         ConfigMng::instance->loadOverrideOptions(d[s]);
@@ -325,12 +500,13 @@ bool TourMng::parseJsonAfterLoading(Json::Value& d)
         participantList = ConfigMng::instance->nameList();
     }
     
-    if (participantList.size() < 2) {
+    // workers get matches from the coordinator
+    if (participantList.size() < 2 && distMode != DistributedMode::worker) {
         std::cerr << "Error: number of players in parametter \"players\" is not enough for a tournament!" << std::endl;
         return false;
     }
     
-    if (type == TourType::none) {
+    if (type == TourType::none && distMode != DistributedMode::worker) {
         std::cerr << "Error: missing parametter \"type\" or it is incorrect (should be \"roundrobin\", \"knockout\")!" << std::endl;
         return false;
     }
@@ -348,6 +524,7 @@ bool TourMng::parseJsonAfterLoading(Json::Value& d)
     if (d.isMember(s)) {
         auto obj = d[s];
         configMng.setSyzygyPath(obj["syzygypath"].asString());
+        syzygyLazyMode = obj.isMember("lazy loading") && obj["lazy loading"].asBool();
     }
     
     s = "game adjudication";
@@ -357,6 +534,45 @@ bool TourMng::parseJsonAfterLoading(Json::Value& d)
         gameConfig.adjudicationEgtbMode = obj.isMember("tablebase") && obj["tablebase"].asBool();
         gameConfig.adjudicationMaxGameLength = obj.isMember("draw if game length over") ? obj["draw if game length over"].asInt() : 0;
         gameConfig.adjudicationMaxPieces = obj.isMember("tablebase max pieces") ? obj["tablebase max pieces"].asInt() : 10;
+        
+        if (obj.isMember("resign score")) gameConfig.adjudicationResignScore = obj["resign score"].asInt();
+        if (obj.isMember("resign move count")) gameConfig.adjudicationResignMoveCount = obj["resign move count"].asInt();
+        if (obj.isMember("resign both engines agree")) gameConfig.adjudicationResignBothAgree = obj["resign both engines agree"].asBool();
+        if (obj.isMember("draw score")) gameConfig.adjudicationDrawScore = obj["draw score"].asInt();
+        if (obj.isMember("draw move count")) gameConfig.adjudicationDrawMoveCount = obj["draw move count"].asInt();
+        if (obj.isMember("draw start ply")) gameConfig.adjudicationDrawStartPly = obj["draw start ply"].asInt();
+    }
+    
+    // workers just play, the coordinator runs the test
+    s = "sprt";
+    if (d.isMember(s) && distMode != DistributedMode::worker) {
+        auto obj = d[s];
+        auto mode = obj.isMember("mode") && obj["mode"].asBool();
+        auto elo0 = obj.isMember("elo0") ? obj["elo0"].asDouble() : 0.0;
+        auto elo1 = obj.isMember("elo1") ? obj["elo1"].asDouble() : 5.0;
+        auto alpha = obj.isMember("alpha") ? obj["alpha"].asDouble() : 0.05;
+        auto beta = obj.isMember("beta") ? obj["beta"].asDouble() : 0.05;
+        
+        if (mode && (type != TourType::roundrobin || participantList.size() != 2)) {
+            std::cout << "Warning: SPRT needs a round robin of two players, it is turned off" << std::endl;
+            mode = false;
+        }
+        
+        sprt.setup(mode, elo0, elo1, alpha, beta);
+        if (mode) {
+            if (!sprt.isValid()) {
+                std::cerr << "Error: \"" << s << "\" needs elo0 smaller than elo1, alpha and beta between 0 and 1" << std::endl;
+                return false;
+            }
+            
+            // each opening is played with both sides
+            sprtPlayer = participantList.front();
+            swapPairSides = true;
+            gameperpair += gameperpair & 1;
+            if (bookMng.getBookSelectType() == BookSelectType::allnew) {
+                bookMng.setBookSelectType(BookSelectType::samepair);
+            }
+        }
     }
     
     s = "logs";
@@ -381,6 +597,9 @@ bool TourMng::parseJsonAfterLoading(Json::Value& d)
             
             logEngineGameTitleSurfix = v.isMember("game title surfix") && v["game title surfix"].asBool();
             logEngineShowTime = v.isMember("show time") && v["show time"].asBool();
+            if (v.isMember("verbosity")) {
+                logEngineVerbosity = EngineLogFilter::string2Verbosity(v["verbosity"].asString());
+            }
             logEnginePath = v["path"].asString();
         }
         
@@ -397,7 +616,7 @@ bool TourMng::parseJsonAfterLoading(Json::Value& d)
     if (gameConfig.adjudicationMode) {
         auto path = configMng.getSyzygyPath();
         if (!path.empty()) {
-            Tablebase::SyzygyTablebase::tb_init(path);
+            Tablebase::SyzygyTablebase::tb_init(path, syzygyLazyMode);
         }
     }
     
@@ -408,6 +627,37 @@ bool TourMng::parseJsonAfterLoading(Json::Value& d)
     }
     std::cout << std::endl;
     
+    // Core slots: engines of a game take turns to think, so they can share
+    // their cores, except when pondering
+    {
+        auto coresPerSlot = std::max(1, configMng.getEngineThreads()) * (gameConfig.ponderMode ? 2 : 1);
+        auto slotCnt = coreSlotMng.setup(coresPerSlot);
+        
+        if (gameConcurrency <= 0) {
+            gameConcurrency = std::max(1, slotCnt);
+        }
+        
+        if (corePinningMode) {
+#ifdef __linux__
+            std::cout << coreSlotMng.toString() << std::endl;
+            if (gameConcurrency > slotCnt) {
+                std::cout << "Warning: concurrency (" << gameConcurrency << ") is larger than the number of core slots (" << slotCnt << "), games without slots won't be pinned" << std::endl;
+            }
+#else
+            std::cout << "Warning: core pinning is supported on Linux only" << std::endl;
+            corePinningMode = false;
+#endif
+        }
+        
+        if (concurrencyMax <= 0) {
+            concurrencyMax = std::max(gameConcurrency, slotCnt);
+        }
+        concurrencyCtrl.setup(gameConcurrency, adaptiveConcurrencyMode, concurrencyMin, concurrencyMax, coresPerSlot);
+        if (adaptiveConcurrencyMode) {
+            gameConcurrency = concurrencyCtrl.getTarget();
+        }
+    }
+    
     // Check cores and memory
     {
         // engine concurrency
@@ -419,9 +669,15 @@ bool TourMng::parseJsonAfterLoading(Json::Value& d)
         if (threads >= cores) {
             std::cout << "Warning: concurrent engines (" << n << ") may use from " << threads << " threads, more than the number of computer cores (" << cores << ")" << std::endl;
         }
-        auto sysMem = getMemorySize() / (1024 * 1024);
-        if (memory >= sysMem * 3 / 4) {
-            std::cout << "Warning: concurrent engines (" << n << ") may use from " << memory << " MB memory" << std::endl;
+        if (memoryBudget.isEnabled()) {
+            memoryBudget.setConfiguredHash(configMng.getEngineMemory());
+            updateMemoryBudget();
+            gameConcurrency = concurrencyCtrl.getTarget();
+        } else {
+            auto sysMem = getMemorySize() / (1024 * 1024);
+            if (memory >= sysMem * 3 / 4) {
+                std::cout << "Warning: concurrent engines (" << n << ") may use from " << memory << " MB memory" << std::endl;
+            }
         }
     }
     return true;
@@ -477,11 +733,555 @@ void TourMng::tickWork()
         } else {
             gameList.erase(it);
         }
+        coreSlotMng.release(game->getCoreSlot());
         delete game;
     }
     
+    if (distMode != DistributedMode::none) {
+        processNetMessages();
+    }
+    
+    if (concurrencyCtrl.update()) {
+        matchLog(concurrencyCtrl.toString(), banksiaVerbose);
+        updateMemoryBudget();
+    }
+    
+    // every 5s
+    if (++memoryTickCnt >= 10) {
+        memoryTickCnt = 0;
+        sampleEngineMemory();
+    }
+    
     if (state == TourState::playing) {
         playMatches();
+        prepareNextMatches();
+    }
+}
+
+void TourMng::prepareNextMatches()
+{
+    // engines crashed or exited while waiting are not worth keeping
+    std::vector<int> stoppedList;
+    for(auto && p : standbyEngineMap) {
+        if (p.second[W]->getState() >= PlayerState::stopping || p.second[B]->getState() >= PlayerState::stopping) {
+            stoppedList.push_back(p.first);
+        }
+    }
+    for(auto && idx : stoppedList) {
+        releaseStandbyEngines(idx);
+    }
+    
+    if (prestartGames <= 0) {
+        return;
+    }
+    
+    // one engine for each game which is about to free its slot
+    auto expectedPly = completedPlyCnt ? int(completedPlySum / completedPlyCnt) : 0;
+    auto nearlyOverCnt = 0, launchingCnt = 0;
+    for(auto && game : gameList) {
+        if (game->isNearlyOver(expectedPly)) {
+            nearlyOverCnt++;
+        }
+        if (game->getState() == GameState::begin) {
+            launchingCnt += 2;
+        }
+    }
+    
+    auto want = std::min(prestartGames, nearlyOverCnt);
+    if (int(standbyEngineMap.size()) >= want) {
+        return;
+    }
+    
+    // limit engines being loaded at the same time (e.g. NNUE files)
+    for(auto && p : standbyEngineMap) {
+        for(auto && engine : p.second) {
+            if (engine->getState() < PlayerState::ready) {
+                launchingCnt++;
+            }
+        }
+    }
+    
+    for(auto && idx : matchRecordList.peekReady(want)) {
+        if (int(standbyEngineMap.size()) >= want || launchingCnt >= maxEngineLaunches) {
+            break;
+        }
+        if (standbyEngineMap.find(idx) != standbyEngineMap.end()) {
+            continue;
+        }
+        
+        auto& record = matchRecordList[idx];
+        std::array<Engine*, 2> engines;
+        for(int sd = 0; sd < 2; sd++) {
+            engines[sd] = playerMng.createEngine(record.playernames[sd]);
+        }
+        if (!engines[W] || !engines[B]) {
+            for(auto && engine : engines) {
+                playerMng.returnPlayer(engine);
+            }
+            continue;
+        }
+        
+        for(auto && engine : engines) {
+            engine->setPonderMode(gameConfig.ponderMode);
+            engine->setStandbyMode(true);
+            engine->setHeld(true);
+            engine->kickStart();
+        }
+        standbyEngineMap[idx] = engines;
+        launchingCnt += 2;
+    }
+}
+
+bool TourMng::startNetwork()
+{
+    switch (distMode) {
+        case DistributedMode::coordinator:
+            // anyone reaching the port could take matches or forge results
+            if (distToken.empty() && !NetNode::isLoopbackAddress(distBind)) {
+                std::cerr << "Error: coordinator needs a token to listen on " << (distBind.empty() ? "all addresses" : distBind) << std::endl;
+                return false;
+            }
+            if (!netNode.listen(distBind, distPort)) {
+                std::cerr << "Error: coordinator cannot listen on " << distBind << ":" << distPort << std::endl;
+                return false;
+            }
+            std::cout << "Coordinator is listening on " << distBind << ":" << distPort << std::endl;
+            break;
+            
+        case DistributedMode::worker:
+            if (workerName.empty()) {
+                workerName = NetNode::getHostName() + "-" + std::to_string(std::rand() % 10000);
+            }
+            std::cout << "Worker " << workerName << " connects to " << distHost << ":" << distPort << std::endl;
+            break;
+            
+        default:
+            break;
+    }
+    return true;
+}
+
+void TourMng::processNetMessages()
+{
+    for(auto && msg : netNode.takeMessages()) {
+        if (distMode == DistributedMode::coordinator) {
+            coordinatorMessage(msg);
+        } else {
+            workerMessage(msg);
+        }
+    }
+    
+    // workers keep (re)connecting, waiting longer after each failure
+    if (distMode == DistributedMode::worker && coordinatorConnId < 0 && !connecting
+        && time(nullptr) - lastConnectTime >= reconnectDelay) {
+        connecting = true;
+        lastConnectTime = time(nullptr);
+        netNode.connectAsync(distHost, distPort);
+    }
+}
+
+bool TourMng::sendNetMessage(int connId, Json::Value data)
+{
+    if (!distToken.empty()) {
+        data["token"] = distToken;
+    }
+    return netNode.send(connId, data);
+}
+
+bool TourMng::isNetMessageAuthorized(const NetMessage& msg) const
+{
+    return msg.event || distToken.empty() || msg.data["token"].asString() == distToken;
+}
+
+void TourMng::coordinatorMessage(const NetMessage& msg)
+{
+    if (!isNetMessageAuthorized(msg)) {
+        std::cout << "Warning: rejected a connection with a wrong token" << std::endl;
+        netNode.disconnect(msg.connId);
+        return;
+    }
+    
+    auto type = msg.data["type"].asString();
+    
+    if (type == "hello" && !msg.event) {
+        WorkerInfo info;
+        info.name = msg.data["name"].asString();
+        if (info.name.empty()) {
+            info.name = "worker-" + std::to_string(msg.connId);
+        }
+        workerConnMap[msg.connId] = info;
+        
+        auto& stats = workerStatsMap[info.name];
+        if (!stats.firstTime) {
+            stats.firstTime = time(nullptr);
+        }
+        stats.connectCnt++;
+        stats.connected = true;
+        
+        Json::Value reply;
+        reply["type"] = "setup";
+        reply["time control"] = timeController.saveToJson();
+        reply["event"] = eventName;
+        reply["site"] = siteName;
+        sendNetMessage(msg.connId, reply);
+        
+        matchLog("* Worker " + info.name + " connected", banksiaVerbose);
+        return;
+    }
+    
+    auto it = workerConnMap.find(msg.connId);
+    if (it == workerConnMap.end()) {
+        return;
+    }
+    
+    if (type == "pull") {
+        auto cnt = std::min(64, std::max(1, msg.data["count"].asInt()));
+        Json::Value matches(Json::arrayValue);
+        while (int(matches.size()) < cnt) {
+            auto idx = matchRecordList.popReady();
+            if (idx < 0) {
+                break;
+            }
+            auto& record = matchRecordList[idx];
+            if (record.startFen.empty() && record.startMoves.empty()) {
+                assignOpening(record);
+            }
+            if (!record.isValid()) {
+                matchRecordList.setState(idx, MatchState::error);
+                continue;
+            }
+            matchRecordList.setState(idx, MatchState::playing);
+            it->second.assignedSet.insert(idx);
+            matches.append(record.saveToJson());
+        }
+        
+        Json::Value reply;
+        reply["type"] = "assign";
+        reply["matches"] = matches;
+        sendNetMessage(msg.connId, reply);
+        return;
+    }
+    
+    if (type == "result") {
+        remoteMatchCompleted(msg);
+        
+        // the worker keeps the result until this arrives
+        Json::Value ack;
+        ack["type"] = "ack";
+        ack["gameIdx"] = msg.data["gameIdx"].asInt();
+        sendNetMessage(msg.connId, ack);
+        return;
+    }
+    
+    if (type == "disconnected" && msg.event) {
+        // re-issue unfinished matches to other workers
+        auto cnt = 0;
+        for(auto && idx : it->second.assignedSet) {
+            if (matchRecordList[idx].state == MatchState::playing) {
+                matchRecordList.setState(idx, MatchState::none);
+                cnt++;
+            }
+        }
+        auto& stats = workerStatsMap[it->second.name];
+        stats.reissuedCnt += cnt;
+        stats.connected = false;
+        
+        matchLog("* Worker " + it->second.name + " disconnected, matches re-issued: " + std::to_string(cnt), true);
+        workerConnMap.erase(it);
+    }
+}
+
+void TourMng::remoteMatchCompleted(const NetMessage& msg)
+{
+    auto& data = msg.data;
+    auto gIdx = data["gameIdx"].asInt();
+    if (gIdx < 0 || gIdx >= int(matchRecordList.size())) {
+        return;
+    }
+    
+    auto& workerInfo = workerConnMap[msg.connId];
+    workerInfo.assignedSet.erase(gIdx);
+    
+    // a re-issued match may be reported twice, the first result wins
+    auto& record = matchRecordList[gIdx];
+    if (record.state == MatchState::completed) {
+        return;
+    }
+    
+    matchRecordList.setState(gIdx, MatchState::completed);
+    record.result.result = string2ResultType(data["result"].asString());
+    record.result.reason = string2ReasonType(data["reason"].asString());
+    
+    workerStatsMap[workerInfo.name].gameCnt++;
+    
+    auto statsArray = data["stats"];
+    for(int sd = 0; sd < 2 && sd < int(statsArray.size()); sd++) {
+        EngineStats engineStats;
+        engineStats.nodes = statsArray[sd]["nodes"].asInt64();
+        engineStats.depths = statsArray[sd]["depths"].asInt64();
+        engineStats.moves = statsArray[sd]["moves"].asInt64();
+        engineStats.elapsed = statsArray[sd]["elapsed"].asDouble();
+        engineStats.games = 1;
+        
+        auto& s = engineStatsMap[record.playernames[sd]];
+        s.add(engineStats);
+    }
+    matchEstimateChanged = true;
+    
+    if (pgnPathMode && !pgnPath.empty()) {
+        append2TextFile(pgnPath, data["pgn"].asString());
+    }
+    
+    auto infoString = std::to_string(gIdx + 1) + ") " + data["title"].asString()
+    + ", #" + std::to_string(data["plies"].asInt())
+    + ", " + record.result.toString() + " [" + workerInfo.name + "]";
+    matchLog(infoString, banksiaVerbose);
+    
+    checkToExtendMatches(gIdx);
+    checkSprt(gIdx);
+    saveMatchRecords();
+}
+
+void TourMng::workerMessage(const NetMessage& msg)
+{
+    if (!isNetMessageAuthorized(msg)) {
+        std::cout << "Warning: the coordinator sent a wrong token" << std::endl;
+        netNode.disconnect(msg.connId);
+        return;
+    }
+    
+    auto type = msg.data["type"].asString();
+    
+    if (type == "connected" && msg.event) {
+        coordinatorConnId = msg.connId;
+        connecting = pullPending = false;
+        reconnectDelay = 1;
+        
+        Json::Value hello;
+        hello["type"] = "hello";
+        hello["name"] = workerName;
+        hello["slots"] = concurrencyCtrl.getTarget();
+        sendNetMessage(coordinatorConnId, hello);
+        
+        // results not acknowledged before, including ones of games finished while being disconnected
+        for(auto && p : resultOutbox) {
+            sendNetMessage(coordinatorConnId, p.second);
+        }
+        
+        matchLog("* Connected to coordinator " + distHost + ":" + std::to_string(distPort), true);
+        return;
+    }
+    
+    if (type == "connectfailed" && msg.event) {
+        connecting = false;
+        reconnectDelay = std::min(30, reconnectDelay * 2);
+        return;
+    }
+    
+    if (msg.connId != coordinatorConnId) {
+        return;
+    }
+    
+    if (type == "disconnected" && msg.event) {
+        coordinatorConnId = -1;
+        pullPending = false;
+        
+        // the coordinator re-issues them
+        for(auto && r : matchRecordList) {
+            if (r.state == MatchState::none) {
+                matchRecordList.setState(r.gameIdx, MatchState::error);
+            }
+        }
+        matchLog("* Lost connection to coordinator, reconnecting", true);
+        return;
+    }
+    
+    if (type == "setup") {
+        TimeController tc;
+        if (tc.load(msg.data["time control"]) && tc.isValid()) {
+            timeController = tc;
+        }
+        eventName = msg.data["event"].asString();
+        siteName = msg.data["site"].asString();
+        return;
+    }
+    
+    if (type == "assign") {
+        pullPending = false;
+        auto matches = msg.data["matches"];
+        if (matches.empty()) {
+            lastEmptyAssignTime = time(nullptr);
+        }
+        for (int i = 0; i < int(matches.size()); i++) {
+            MatchRecord record;
+            record.load(matches[i]);
+            auto remoteIdx = record.gameIdx;
+            record.gameIdx = int(matchRecordList.size());
+            remoteGameIdxMap[record.gameIdx] = remoteIdx;
+            matchRecordList.push_back(record);
+        }
+        return;
+    }
+    
+    if (type == "ack") {
+        resultOutbox.erase(msg.data["gameIdx"].asInt());
+        return;
+    }
+    
+    if (type == "done") {
+        matchLog("* Coordinator: tournament finished", true);
+        finishTournament();
+    }
+}
+
+void TourMng::requestRemoteMatches()
+{
+    if (coordinatorConnId < 0 || pullPending || time(nullptr) - lastEmptyAssignTime < 2) {
+        return;
+    }
+    
+    // keep a batch of matches ahead of free slots
+    auto cnt = concurrencyCtrl.getTarget() + distBatch - int(gameList.size()) - matchRecordList.count(MatchState::none);
+    if (cnt <= 0) {
+        return;
+    }
+    
+    Json::Value pull;
+    pull["type"] = "pull";
+    pull["count"] = cnt;
+    pullPending = sendNetMessage(coordinatorConnId, pull);
+}
+
+void TourMng::sendRemoteResult(Game* game, const MatchRecord& record, const EngineStats* engineStats)
+{
+    auto it = remoteGameIdxMap.find(record.gameIdx);
+    if (it == remoteGameIdxMap.end()) {
+        return;
+    }
+    
+    Json::Value result;
+    result["type"] = "result";
+    result["gameIdx"] = it->second;
+    result["result"] = resultType2String(record.result.result);
+    result["reason"] = reasonType2String(record.result.reason);
+    result["title"] = game->getGameTitleString();
+    result["plies"] = int(game->board.histList.size());
+    result["pgn"] = game->toPgn(eventName, siteName, record.round, it->second, logPgnRichMode);
+    
+    Json::Value statsArray(Json::arrayValue);
+    for(int sd = 0; sd < 2; sd++) {
+        Json::Value s;
+        s["nodes"] = Json::Int64(engineStats[sd].nodes);
+        s["depths"] = Json::Int64(engineStats[sd].depths);
+        s["moves"] = Json::Int64(engineStats[sd].moves);
+        s["elapsed"] = engineStats[sd].elapsed;
+        statsArray.append(s);
+    }
+    result["stats"] = statsArray;
+    
+    resultOutbox[it->second] = result;
+    if (coordinatorConnId >= 0) {
+        sendNetMessage(coordinatorConnId, result);
+    }
+}
+
+std::string TourMng::createWorkerStats() const
+{
+    std::ostringstream stringStream;
+    stringStream << "Workers:";
+    
+    auto now = time(nullptr);
+    for(auto && p : workerStatsMap) {
+        auto& stats = p.second;
+        auto playingCnt = 0;
+        for(auto && w : workerConnMap) {
+            if (w.second.name == p.first) {
+                playingCnt += int(w.second.assignedSet.size());
+            }
+        }
+        auto hours = std::max(1.0, double(now - stats.firstTime)) / 3600;
+        stringStream << std::endl << "  " << p.first
+        << ": games: " << stats.gameCnt
+        << ", games/hour: " << std::fixed << std::setprecision(1) << stats.gameCnt / hours
+        << ", playing: " << playingCnt
+        << ", connections: " << stats.connectCnt
+        << ", re-issued: " << stats.reissuedCnt
+        << (stats.connected ? "" : ", disconnected");
+    }
+    return stringStream.str();
+}
+
+void TourMng::releaseStandbyEngines(int gameIdx)
+{
+    auto it = standbyEngineMap.find(gameIdx);
+    if (it != standbyEngineMap.end()) {
+        for(auto && engine : it->second) {
+            engine->setStandbyMode(false);
+            engine->setHeld(false);
+            playerMng.returnPlayer(engine);
+        }
+        standbyEngineMap.erase(it);
+    }
+}
+
+// Engines whose files are unchanged since the JSON maker probed them have known
+// option lists, they start with a short handshake
+void TourMng::markTrustedProfiles(const std::string& cachePath)
+{
+    ProbeCache probeCache;
+    if (!probeCache.loadFromJsonFile(cachePath, false)) {
+        std::cout << "Warning: trusted profiles are on but the probe cache " << cachePath << " can't be loaded (run the JSON maker to create it)" << std::endl;
+        return;
+    }
+    
+    auto cnt = 0;
+    for(auto && config : ConfigMng::instance->configList()) {
+        auto isEngine = false;
+        Config cachedConfig;
+        if (probeCache.lookup(config.command, isEngine, cachedConfig) && isEngine && cachedConfig.protocol == config.protocol) {
+            ConfigMng::instance->setTrustedProfile(config.name, true);
+            cnt++;
+        }
+    }
+    
+    std::cout << "Trusted engine profiles: " << cnt << " of " << ConfigMng::instance->size() << std::endl;
+}
+
+void TourMng::sampleEngineMemory()
+{
+    if (!memoryBudget.isEnabled()) {
+        return;
+    }
+    
+    for(auto && game : gameList) {
+        for(int sd = 0; sd < 2; sd++) {
+            auto engine = dynamic_cast<Engine*>(game->getPlayer(static_cast<Side>(sd)));
+            if (engine == nullptr) {
+                continue;
+            }
+            auto rss = MemoryBudget::getProcessMemory(engine->getProcessId());
+            memoryBudget.addSample(engine->getName(), rss, engine->getHashSize());
+        }
+    }
+    
+    updateMemoryBudget();
+}
+
+void TourMng::updateMemoryBudget()
+{
+    // coordinators run no engines
+    if (!memoryBudget.isEnabled() || distMode == DistributedMode::coordinator) {
+        return;
+    }
+    
+    auto changed = memoryBudget.update(concurrencyCtrl.getWantedTarget(), prestartGames);
+    concurrencyCtrl.setLimit(memoryBudget.getConcurrencyCap());
+    if (configMng.getEngineMemory() > 0) {
+        configMng.setEngineMemory(memoryBudget.getHash());
+    }
+    
+    if (changed) {
+        matchLog("Memory budget: " + memoryBudget.getLastChange(), banksiaVerbose);
     }
 }
 
@@ -490,6 +1290,27 @@ static std::string bool2OnOffString(bool b)
     return b ? "on" : "off";
 }
 
+void TourMng::setConcurrency(int n)
+{
+    concurrencyCtrl.setTarget(n);
+    std::cout << concurrencyCtrl.toString() << std::endl;
+}
+
+void TourMng::setAdaptiveConcurrency(bool enabled)
+{
+    concurrencyCtrl.setAdaptive(enabled);
+    std::cout << concurrencyCtrl.toString() << std::endl;
+}
+
+std::string TourMng::getConcurrencyInfo() const
+{
+    auto str = concurrencyCtrl.toString();
+    if (memoryBudget.isEnabled() && distMode != DistributedMode::coordinator) {
+        str += "\n" + memoryBudget.toString();
+    }
+    return str;
+}
+
 void TourMng::showPathInfo(const std::string& name, const std::string& path, bool mode)
 {
     std::cout << " " << name << ": " << (path.empty() ? "<empty>" : path) << ", " << bool2OnOffString(mode) << std::endl;
@@ -544,6 +1365,7 @@ void TourMng::showTournamentInfo()
     info +=
     + ", matches: " + std::to_string(calcMatchNumber())
     + ", concurrency: " + std::to_string(gameConcurrency)
+    + (adaptiveConcurrencyMode ? " (adaptive " + std::to_string(concurrencyMin) + "-" + std::to_string(concurrencyMax) + ")" : "")
     + ", ponder: " + bool2OnOffString(gameConfig.ponderMode)
     + ", book: " + bool2OnOffString(!bookMng.isEmpty());
     
@@ -552,6 +1374,9 @@ void TourMng::showTournamentInfo()
     showPathInfo("pgn", pgnPath, pgnPathMode);
     showPathInfo("result", logResultPath, logResultMode);
     showPathInfo("engines", logEnginePath, logEngineMode);
+    if (logEngineMode && logEngineVerbosity != LogVerbosity::all) {
+        std::cout << " engine log verbosity: " << EngineLogFilter::verbosity2String(logEngineVerbosity) << std::endl;
+    }
     std::cout << std::endl;
 }
 
@@ -580,43 +1405,250 @@ void TourMng::finishTournament()
     
     removeMatchRecordFile();
     
+    Json::Value done;
+    done["type"] = "done";
+    for(auto && p : workerConnMap) {
+        sendNetMessage(p.first, done);
+    }
+    
     // WARNING: exit the app here after completed the tournament
     shutdown();
     exit(0);
 }
 
-void TourMng::playMatches()
+void TourMng::playMatches()
+{
+    if (matchRecordList.empty() && distMode != DistributedMode::worker) {
+        return finishTournament();
+    }
+    
+    orderReadyMatches();
+    
+    // the coordinator hands matches out to workers instead of playing them
+    auto concurrency = distMode == DistributedMode::coordinator ? 0 : size_t(concurrencyCtrl.getTarget());
+    while (gameList.size() < concurrency) {
+        auto idx = matchRecordList.popReady();
+        if (idx < 0) {
+            break;
+        }
+        
+        auto& m = matchRecordList[idx];
+        createMatch(m);
+        assert(m.state != MatchState::none);
+        if (m.state == MatchState::playing) {
+            matchStartMap[idx] = std::chrono::steady_clock::now();
+        }
+    }
+    
+    if (distMode == DistributedMode::worker) {
+        return requestRemoteMatches();
+    }
+    
+    if (gameList.empty() && !matchRecordList.count(MatchState::playing) && !matchRecordList.count(MatchState::none)) {
+        finishMakespan();
+        if (!createNextRoundMatches()) {
+            return finishTournament();
+        }
+    }
+}
+
+void TourMng::updateMatchEstimates()
+{
+    engineGameTimeMap.clear();
+    auto sum = 0.0;
+    for(auto && p : engineStatsMap) {
+        auto& stats = p.second;
+        if (stats.games <= 0 || stats.moves <= 0) {
+            continue;
+        }
+        // average moves per game x average time per move
+        auto movesPerGame = double(stats.moves) / stats.games;
+        auto t = movesPerGame * stats.elapsed / double(stats.moves);
+        engineGameTimeMap[p.first] = t;
+        sum += t;
+    }
+    
+    if (!engineGameTimeMap.empty()) {
+        defaultEngineGameTime = sum / engineGameTimeMap.size();
+        return;
+    }
+    
+    // nothing played yet, guess from the time control
+    auto moves = completedPlyCnt ? double(completedPlySum) / completedPlyCnt / 2 : 40.0;
+    switch (timeController.mode) {
+        case TimeControlMode::movetime:
+            defaultEngineGameTime = timeController.time * moves;
+            break;
+        case TimeControlMode::standard:
+            defaultEngineGameTime = timeController.increment * moves
+            + (timeController.moves > 0 ? timeController.time * std::min(1.0, moves / timeController.moves) : timeController.time);
+            break;
+        default:
+            defaultEngineGameTime = 0;
+            break;
+    }
+}
+
+double TourMng::estimateMatchDuration(const MatchRecord& record) const
+{
+    auto d = matchOverheadCnt ? matchOverheadSum / matchOverheadCnt : 0.0;
+    for(int sd = 0; sd < 2; sd++) {
+        auto it = engineGameTimeMap.find(record.playernames[sd]);
+        d += it != engineGameTimeMap.end() ? it->second : defaultEngineGameTime;
+    }
+    return d;
+}
+
+// true if an engine game time has moved over 10% since the ready queue was sorted
+bool TourMng::isReadyOrderStale() const
+{
+    auto moved = [](double oldTime, double newTime) {
+        return std::abs(newTime - oldTime) > 0.1 * std::max(oldTime, newTime);
+    };
+    
+    if (engineGameTimeMap.size() != sortedEngineGameTimeMap.size()
+        || moved(sortedDefaultEngineGameTime, defaultEngineGameTime)) {
+        return true;
+    }
+    
+    for(auto && p : engineGameTimeMap) {
+        auto it = sortedEngineGameTimeMap.find(p.first);
+        if (it == sortedEngineGameTimeMap.end() || moved(it->second, p.second)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void TourMng::orderReadyMatches()
+{
+    auto stamp = matchRecordList.getReadyStamp();
+    auto newMatches = stamp != readyStamp;
+    if (!newMatches && !matchEstimateChanged) {
+        return;
+    }
+    readyStamp = stamp;
+    matchEstimateChanged = false;
+    
+    updateMatchEstimates();
+    
+    // every game nudges the averages, re-sorting for that would cost
+    // O(N log N) per game
+    if (matchOrder == MatchOrder::longestfirst && (newMatches || isReadyOrderStale())) {
+        sortedEngineGameTimeMap = engineGameTimeMap;
+        sortedDefaultEngineGameTime = defaultEngineGameTime;
+        
+        // all games of a pair have the same players
+        std::unordered_map<int, double> pairEstimateMap;
+        matchRecordList.sortReady([&](int idx) {
+            // engines started in advance are waiting for their matches
+            if (standbyEngineMap.find(idx) != standbyEngineMap.end()) {
+                return std::numeric_limits<double>::max();
+            }
+            auto& record = matchRecordList[idx];
+            auto it = pairEstimateMap.find(record.pairId);
+            if (it != pairEstimateMap.end()) {
+                return it->second;
+            }
+            auto d = estimateMatchDuration(record);
+            pairEstimateMap[record.pairId] = d;
+            return d;
+        });
+    }
+    
+    // workers and the coordinator do not know all slots. A plan guessed
+    // from the time control is revised once the first games are done
+    if (distMode == DistributedMode::none
+        && (newMatches || (makespanPlanning && !makespanFromStats && !engineGameTimeMap.empty()))) {
+        planMakespan();
+    }
+}
+
+void TourMng::planMakespan()
 {
-    if (matchRecordList.empty()) {
-        return finishTournament();
+    auto now = std::chrono::steady_clock::now();
+    if (!makespanPlanning) {
+        makespanPlanning = true;
+        makespanStart = now;
     }
     
-    if (gameList.size() >= gameConcurrency) {
+    // slots are free when their playing games are expected to end
+    std::vector<double> slotVec;
+    for(auto it = matchStartMap.begin(); it != matchStartMap.end();) {
+        if (matchRecordList[it->first].state != MatchState::playing) {
+            it = matchStartMap.erase(it);
+            continue;
+        }
+        auto passed = std::chrono::duration<double>(now - it->second).count();
+        slotVec.push_back(std::max(0.0, estimateMatchDuration(matchRecordList[it->first]) - passed));
+        ++it;
+    }
+    slotVec.resize(std::max(slotVec.size(), size_t(std::max(1, concurrencyCtrl.getTarget()))), 0.0);
+    
+    // list scheduling: each match, in the order of the queue, takes the earliest free slot
+    std::priority_queue<double, std::vector<double>, std::greater<double>> slotQueue(slotVec.begin(), slotVec.end());
+    auto end = *std::max_element(slotVec.begin(), slotVec.end());
+    auto readyVec = matchRecordList.peekReady(int(matchRecordList.size()));
+    for(auto && idx : readyVec) {
+        auto t = slotQueue.top() + estimateMatchDuration(matchRecordList[idx]);
+        slotQueue.pop();
+        slotQueue.push(t);
+        end = std::max(end, t);
+    }
+    
+    // zero when there is nothing to estimate from (e.g. depth control, no stats)
+    makespanFromStats = !engineGameTimeMap.empty();
+    auto known = makespanFromStats || matchOverheadCnt || defaultEngineGameTime > 0;
+    plannedMakespan = known ? std::chrono::duration<double>(now - makespanStart).count() + end : 0;
+    
+    matchLog("Planned makespan: " + (plannedMakespan > 0 ? formatPeriod(int(plannedMakespan + 0.5)) : std::string("unknown"))
+             + ", matches: " + std::to_string(readyVec.size())
+             + ", order: " + (matchOrder == MatchOrder::longestfirst ? "longest first" : "listed"), banksiaVerbose);
+}
+
+void TourMng::finishMakespan()
+{
+    if (!makespanPlanning) {
         return;
     }
+    makespanPlanning = false;
     
-    for(auto && m : matchRecordList) {
-        if (m.state != MatchState::none) {
-            continue;
-        }
-        
-        createMatch(m);
-        assert(m.state != MatchState::none);
-        
-        if (gameList.size() >= gameConcurrency) {
-            break;
-        }
+    auto actual = std::chrono::duration<double>(std::chrono::steady_clock::now() - makespanStart).count();
+    makespanList.push_back(std::make_pair(plannedMakespan, actual));
+    
+    auto p = makespanList.back();
+    matchLog("Makespan: planned " + (p.first > 0 ? formatPeriod(int(p.first + 0.5)) : std::string("unknown"))
+             + ", actual " + formatPeriod(int(p.second + 0.5)), banksiaVerbose);
+}
+
+std::string TourMng::makespanToString() const
+{
+    auto planned = 0.0, actual = 0.0;
+    auto unknown = false;
+    for(auto && p : makespanList) {
+        planned += p.first;
+        actual += p.second;
+        unknown |= p.first <= 0;
     }
     
-    if (gameList.empty() && !createNextRoundMatches()) {
-        return finishTournament();
+    std::ostringstream stringStream;
+    stringStream << "Makespan (" << (matchOrder == MatchOrder::longestfirst ? "longest first" : "listed")
+    << "): planned " << (unknown ? std::string("unknown") : formatPeriod(int(planned + 0.5)))
+    << ", actual " << formatPeriod(int(actual + 0.5));
+    if (makespanList.size() > 1) {
+        stringStream << ", rounds: " << makespanList.size();
     }
+    return stringStream.str();
 }
 
 void TourMng::addMatchRecord(MatchRecord& record)
 {
     record.pairId = std::rand();
     for(int i = 0; i < gameperpair; i++) {
+        // SPRT counts game pairs, each of them has its own opening
+        if (sprt.isEnabled() && i % 2 == 0) {
+            record.pairId = int(matchRecordList.size());
+        }
         addMatchRecord_simple(record);
         if (swapPairSides) {
             record.swapPlayers();
@@ -637,10 +1669,41 @@ void TourMng::addMatchRecord_simple(MatchRecord& record)
         }
     }
     record.gameIdx = int(matchRecordList.size());
-    bookMng.getRandomBook(record.pairId, record.startFen, record.startMoves);
     matchRecordList.push_back(record);
 }
 
+void TourMng::assignOpening(MatchRecord& record)
+{
+    if (bookMng.getBookSelectType() != BookSelectType::samepair) {
+        bookMng.getRandomBook(record.gameIdx, record.pairId, record.startFen, record.startMoves);
+        return;
+    }
+    
+    // the cache of the book is gone after resuming, records keep the openings
+    auto found = false;
+    for(auto && idx : matchRecordList.getPair(record.pairId)) {
+        auto& r = matchRecordList[idx];
+        if (idx != record.gameIdx && (!r.startFen.empty() || !r.startMoves.empty())) {
+            record.startFen = r.startFen;
+            record.startMoves = r.startMoves;
+            found = true;
+            break;
+        }
+    }
+    
+    if (!found) {
+        bookMng.getRandomBook(record.gameIdx, record.pairId, record.startFen, record.startMoves);
+    }
+    
+    // release the cached opening when all games of the pair have got it
+    for(auto && idx : matchRecordList.getPair(record.pairId)) {
+        if (idx != record.gameIdx && matchRecordList[idx].state == MatchState::none) {
+            return;
+        }
+    }
+    bookMng.releasePair(record.pairId);
+}
+
 bool TourMng::createNextRoundMatches()
 {
     switch (type) {
@@ -659,6 +1722,130 @@ bool TourMng::createNextRoundMatches()
     return false;
 }
 
+void TourMng::initSprt()
+{
+    if (!sprt.isEnabled()) {
+        return;
+    }
+    
+    // from resumed matches
+    sprt.clear();
+    std::set<int> pairIdSet;
+    for(auto && r : matchRecordList) {
+        if (r.state == MatchState::completed && pairIdSet.insert(r.pairId).second) {
+            addSprtPair(r.pairId);
+        }
+    }
+    
+    updateSprt();
+}
+
+bool TourMng::addSprtPair(int pairId)
+{
+    auto& idxVec = matchRecordList.getPair(pairId);
+    if (idxVec.size() != 2) {
+        return false;
+    }
+    
+    auto score = 0.0;
+    for(auto && idx : idxVec) {
+        auto& r = matchRecordList[idx];
+        if (r.state != MatchState::completed || r.result.result == ResultType::noresult) {
+            return false;
+        }
+        
+        auto whiteScore = r.result.result == ResultType::win ? 1.0 : r.result.result == ResultType::draw ? 0.5 : 0.0;
+        score += r.playernames[W] == sprtPlayer ? whiteScore : 1.0 - whiteScore;
+    }
+    
+    sprt.addPair(score);
+    return true;
+}
+
+void TourMng::checkSprt(int gIdx)
+{
+    if (!sprt.isEnabled() || gIdx < 0 || gIdx >= int(matchRecordList.size()) || sprt.getResult() != SprtResult::none) {
+        return;
+    }
+    
+    if (addSprtPair(matchRecordList[gIdx].pairId)) {
+        updateSprt();
+    }
+}
+
+void TourMng::updateSprt()
+{
+    if (sprt.getResult() != SprtResult::none || sprt.update() == SprtResult::none) {
+        return;
+    }
+    
+    // games being played are still counted
+    auto cancelledCnt = 0;
+    for(int idx = 0; idx < int(matchRecordList.size()); idx++) {
+        if (matchRecordList[idx].state == MatchState::none) {
+            releaseStandbyEngines(idx);
+            matchRecordList.setState(idx, MatchState::error);
+            cancelledCnt++;
+        }
+    }
+    
+    auto str = "* " + sprt.toString() + ". Stopped, " + std::to_string(cancelledCnt) + " games cancelled";
+    matchLog(str, true);
+}
+
+// false if some games of the pair are not completed
+bool TourMng::collectKnockoutPair(int pairId, TourPlayerPair& playerPair) const
+{
+    auto& idxVec = matchRecordList.getPair(pairId);
+    if (idxVec.empty()) {
+        return false;
+    }
+    
+    auto& r = matchRecordList[idxVec.front()];
+    playerPair.pair[0].name = r.playernames[0];
+    playerPair.pair[1].name = r.playernames[1];
+    
+    for(auto && idx : idxVec) {
+        auto& rcd = matchRecordList[idx];
+        
+        // some matches are not completed -> no extend
+        if (rcd.state != MatchState::completed) {
+            return false;
+        }
+        if (rcd.result.result != ResultType::win && rcd.result.result  != ResultType::loss) {
+            continue;
+        }
+        auto winnerName = rcd.playernames[(rcd.result.result  == ResultType::win ? W : B)];
+        playerPair.pair[playerPair.pair[W].name == winnerName ? W : B].winCnt++;
+        
+        auto whiteIdx = playerPair.pair[W].name == rcd.playernames[W] ? W : B;
+        playerPair.pair[whiteIdx].whiteCnt++;
+    }
+    return true;
+}
+
+// It is a tie if two players have same wins and same times to play white,
+// otherwise the one who has more wins or fewer whites is the winner
+static bool isKnockoutPairTied(const TourPlayerPair& playerPair)
+{
+    return playerPair.pair[0].winCnt == playerPair.pair[1].winCnt && playerPair.pair[0].whiteCnt == playerPair.pair[1].whiteCnt;
+}
+
+std::string TourMng::getKnockoutPairWinner(int pairId) const
+{
+    TourPlayerPair thePair;
+    if (!collectKnockoutPair(pairId, thePair) || isKnockoutPairTied(thePair)) {
+        return "";
+    }
+    
+    auto winIdx = W;
+    if (thePair.pair[B].winCnt > thePair.pair[W].winCnt ||
+        (thePair.pair[B].winCnt == thePair.pair[W].winCnt && thePair.pair[B].whiteCnt < thePair.pair[W].whiteCnt)) {
+        winIdx = B;
+    }
+    return thePair.pair[winIdx].name;
+}
+
 // This function used to break the tie between a pair of players in knockout
 // It is not a tie if one has more win or more white games
 void TourMng::checkToExtendMatches(int gIdx)
@@ -667,54 +1854,36 @@ void TourMng::checkToExtendMatches(int gIdx)
         return;
     }
     
-    for(auto && r : matchRecordList) {
-        if (r.gameIdx == gIdx) {
-            TourPlayerPair playerPair;
-            playerPair.pair[0].name = r.playernames[0];
-            playerPair.pair[1].name = r.playernames[1];
-            auto pairId = r.pairId;
-            
-            for(auto && rcd : matchRecordList) {
-                if (rcd.pairId != pairId) {
-                    continue;
-                }
-                
-                // some matches are not completed -> no extend
-                if (rcd.state != MatchState::completed) {
-                    return;
-                }
-                if (rcd.result.result != ResultType::win && rcd.result.result  != ResultType::loss) {
-                    continue;
-                }
-                auto winnerName = rcd.playernames[(rcd.result.result  == ResultType::win ? W : B)];
-                playerPair.pair[playerPair.pair[W].name == winnerName ? W : B].winCnt++;
-                
-                auto whiteIdx = playerPair.pair[W].name == rcd.playernames[W] ? W : B;
-                playerPair.pair[whiteIdx].whiteCnt++;
-            }
-            
-            // It is a tie if two players have same wins and same times to play white
-            if (playerPair.pair[0].winCnt == playerPair.pair[1].winCnt && playerPair.pair[0].whiteCnt == playerPair.pair[1].whiteCnt) {
-                MatchRecord record = r;
-                record.result.result  = ResultType::noresult;
-                record.state = MatchState::none;
-                addMatchRecord_simple(record);
-                
-                auto str = "* Tied! Add one more game for " + record.playernames[W] + " vs " + record.playernames[B];
-                matchLog(str, banksiaVerbose);
-            }
-            break;
-        }
+    if (gIdx >= int(matchRecordList.size())) {
+        return;
+    }
+    
+    auto& r = matchRecordList[gIdx];
+    TourPlayerPair playerPair;
+    if (!collectKnockoutPair(r.pairId, playerPair)) {
+        return;
+    }
+    
+    if (isKnockoutPairTied(playerPair)) {
+        MatchRecord record = r;
+        record.result.result  = ResultType::noresult;
+        record.state = MatchState::none;
+        record.startFen = "";
+        record.startMoves.clear();
+        addMatchRecord_simple(record);
+        
+        auto str = "* Tied! Add one more game for " + record.playernames[W] + " vs " + record.playernames[B];
+        matchLog(str, banksiaVerbose);
+        return;
     }
+    
+    // the pair is decided, its next round match may be ready
+    createReadyKnockoutMatches(nullptr);
 }
 
 int TourMng::getLastRound() const
 {
-    int lastRound = 0;
-    for(auto && r : matchRecordList) {
-        lastRound = std::max(lastRound, r.round);
-    }
-    return lastRound;
+    return matchRecordList.getLastRound();
 }
 
 void TourMng::reset()
@@ -795,27 +1964,64 @@ bool TourMng::createMatchList(std::vector<std::string> nameList, TourType tourTy
 
 void TourMng::createMatch(MatchRecord& record)
 {
+    // openings are assigned lazily, just before the game starts, since
+    // some books (e.g. Polyglot) are costly to query for whole match lists
+    if (record.startFen.empty() && record.startMoves.empty()) {
+        assignOpening(record);
+    }
+    
     if (!record.isValid() ||
         !createMatch(record.gameIdx, record.playernames[W], record.playernames[B], record.startFen, record.startMoves)) {
         std::cerr << "Error: match record invalid or missing players " << record.toString() << std::endl;
-        record.state = MatchState::error;
+        matchRecordList.setState(record.gameIdx, MatchState::error);
         return;
     }
     
-    record.state = MatchState::playing;
+    matchRecordList.setState(record.gameIdx, MatchState::playing);
 }
 
 bool TourMng::createMatch(int gameIdx, const std::string& whiteName, const std::string& blackName,
                           const std::string& startFen, const std::vector<Move>& startMoves)
 {
-    Engine* engines[2];
-    engines[W] = playerMng.createEngine(whiteName);
-    engines[B] = playerMng.createEngine(blackName);
+    Engine* engines[2] = { nullptr, nullptr };
+    
+    // engines may have been started in advance
+    auto it = standbyEngineMap.find(gameIdx);
+    if (it != standbyEngineMap.end()) {
+        if (it->second[W]->getState() < PlayerState::stopping && it->second[B]->getState() < PlayerState::stopping) {
+            engines[W] = it->second[W];
+            engines[B] = it->second[B];
+            engines[W]->setHeld(false);
+            engines[B]->setHeld(false);
+            standbyEngineMap.erase(it);
+        } else {
+            releaseStandbyEngines(gameIdx);
+        }
+    }
+    
+    if (!engines[W]) {
+        engines[W] = playerMng.createEngine(whiteName);
+        engines[B] = playerMng.createEngine(blackName);
+    }
     
     if (engines[0] && engines[1]) {
         auto game = new Game(engines[W], engines[B], timeController, gameConfig);
         game->setStartup(gameIdx, startFen, startMoves);
         
+        for(int sd = 0; sd < 2; sd++) {
+            engines[sd]->setLogVerbosity(logEngineVerbosity);
+        }
+        
+        if (corePinningMode) {
+            auto slot = coreSlotMng.acquire();
+            if (slot >= 0) {
+                auto cores = coreSlotMng.getCores(slot);
+                engines[W]->setCpuAffinity(cores);
+                engines[B]->setCpuAffinity(cores);
+                game->setCoreSlot(slot);
+            }
+        }
+        
         if (addGame(game)) {
             game->setMessageLogger([=](const std::string& name, const std::string& line, LogType logType) {
                 auto white = game->getPlayer(Side::white);
@@ -836,6 +2042,7 @@ bool TourMng::createMatch(int gameIdx, const std::string& whiteName, const std::
             
             return true;
         }
+        coreSlotMng.release(game->getCoreSlot());
         delete game;
     }
     
@@ -845,58 +2052,114 @@ bool TourMng::createMatch(int gameIdx, const std::string& whiteName, const std::
     return false;
 }
 
-std::vector<TourPlayer> TourMng::getKnockoutWinnerList()
+// Players of a round are entrants of a bracket: the first two play a pair, so do
+// the next two... The odd last one gets a bye. Winners, after the bye of the
+// previous round, are entrants of the next round. A pair is created as soon as
+// both of its feeder pairs are decided, without waiting for the whole round
+int TourMng::createReadyKnockoutMatches(std::string* champion)
 {
-    std::vector<TourPlayer> winList;
-    auto lastRound = getLastRound();
-    
-    std::set<std::string> lostSet;
-    std::vector<std::string> nameList;
-    std::map<int, TourPlayerPair> pairMap;
-    
-    for(auto && r : matchRecordList) {
-        if (r.round != lastRound) {
-            continue;
+    auto createdCnt = 0;
+    std::vector<std::string> entrants; // empty names: not decided yet
+    
+    for(int round = 0; ; round++) {
+        // pairs and byes of the round by player names
+        std::map<std::pair<std::string, std::string>, int> pairIdMap;
+        std::vector<std::pair<std::string, std::string>> slotVec;
+        std::vector<std::string> byeVec;
+        
+        for(auto && idx : matchRecordList.getRound(round)) {
+            auto& r = matchRecordList[idx];
+            if (r.playernames[0].empty() || r.playernames[1].empty()) {
+                byeVec.push_back(r.playernames[r.playernames[0].empty() ? 1 : 0]);
+                continue;
+            }
+            std::pair<std::string, std::string> key = std::minmax(r.playernames[0], r.playernames[1]);
+            if (pairIdMap.find(key) == pairIdMap.end()) {
+                pairIdMap[key] = r.pairId;
+                
+                // the first round was paired at once
+                if (round == 0) {
+                    slotVec.push_back(std::make_pair(r.playernames[0], r.playernames[1]));
+                }
+            }
+        }
+        
+        std::string byeName;
+        if (round > 0) {
+            for(size_t k = 0; k + 1 < entrants.size(); k += 2) {
+                slotVec.push_back(std::make_pair(entrants.at(k), entrants.at(k + 1)));
+            }
+            
+            if (entrants.size() & 1) {
+                byeName = entrants.back();
+                if (!byeName.empty() && std::find(byeVec.begin(), byeVec.end(), byeName) == byeVec.end()) {
+                    MatchRecord record(byeName, "", false);
+                    record.round = round;
+                    record.state = MatchState::completed;
+                    record.result.result = ResultType::win;
+                    record.pairId = std::rand();
+                    addMatchRecord_simple(record);
+                    
+                    auto str = "\n* Player " + byeName + " is an odd one (no opponent to pair with) and receives a bye (a win) for round " + std::to_string(round + 1);
+                    matchLog(str, banksiaVerbose);
+                }
+            }
         }
         
-        assert(r.state == MatchState::completed);
-        TourPlayerPair thePair;
-        auto it = pairMap.find(r.pairId);
-        if (it != pairMap.end()) thePair = it->second;
-        else {
-            thePair.pair[0].name = r.playernames[0];
-            thePair.pair[1].name = r.playernames[1];
+        // byes play first in the next round, thus they won't get byes again
+        std::vector<std::string> nextEntrants;
+        if (round > 0) {
+            if (entrants.size() & 1) {
+                nextEntrants.push_back(byeName);
+            }
+        } else {
+            nextEntrants = byeVec;
         }
         
-        if (r.result.result == ResultType::win || r.result.result == ResultType::loss) {
-            auto idxW = thePair.pair[W].name == r.playernames[W] ? W : B;
-            auto winIdx = r.result.result == ResultType::win ? idxW : (1 - idxW);
-            thePair.pair[winIdx].winCnt++;
+        for(auto && slot : slotVec) {
+            std::string winner;
+            if (!slot.first.empty() && !slot.second.empty()) {
+                std::pair<std::string, std::string> key = std::minmax(slot.first, slot.second);
+                auto it = pairIdMap.find(key);
+                if (it != pairIdMap.end()) {
+                    winner = getKnockoutPairWinner(it->second);
+                } else {
+                    MatchRecord record(slot.first, slot.second, swapPairSides && (rand() & 1));
+                    record.round = round;
+                    addMatchRecord(record);
+                    createdCnt++;
+                    
+                    auto str = "\nknockout round: " + std::to_string(round + 1) + ", " + slot.first + " vs " + slot.second + ", matches: " + std::to_string(uncompletedMatches());
+                    matchLog(str, true);
+                }
+            }
+            nextEntrants.push_back(winner);
         }
-        auto whiteSd = thePair.pair[W].name == r.playernames[W] ? W : B;
-        thePair.pair[whiteSd].whiteCnt++;
-        pairMap[r.pairId] = thePair;
-    }
-    
-    for(auto && p : pairMap) {
-        auto thePair = p.second;
-        assert(thePair.pair[0].winCnt != thePair.pair[1].winCnt || thePair.pair[0].whiteCnt != thePair.pair[1].whiteCnt);
-        auto winIdx = W;
-        if (thePair.pair[B].winCnt > thePair.pair[W].winCnt ||
-            (thePair.pair[B].winCnt == thePair.pair[W].winCnt && thePair.pair[B].whiteCnt < thePair.pair[W].whiteCnt)) {
-            winIdx = B;
+        
+        if (nextEntrants.size() <= 1) {
+            if (champion && !nextEntrants.empty()) {
+                *champion = nextEntrants.front();
+            }
+            break;
         }
-        winList.push_back(thePair.pair[winIdx]);
+        entrants = nextEntrants;
     }
     
-    return winList;
+    return createdCnt;
 }
 
-
 bool TourMng::createNextKnockoutMatchList()
 {
-    auto list = getKnockoutWinnerList();
-    return pairingMatchList(list, getLastRound() + 1);
+    std::string champion;
+    if (createReadyKnockoutMatches(&champion) > 0) {
+        return true;
+    }
+    
+    if (!champion.empty()) {
+        auto str = "\n* The winner is " + champion;
+        matchLog(str, true);
+    }
+    return false;
 }
 
 bool TourMng::createNextSwisstMatchList()
@@ -921,51 +2184,6 @@ bool TourMng::pairingMatchList(const std::vector<std::string>& nameList)
     return pairingMatchList(vec, 0);
 }
 
-bool TourMng::pairingMatchListRecusive(std::vector<TourPlayer>& playerVec, int round, const std::set<std::string>& pairedSet)
-{
-    auto n = playerVec.size(); assert((n & 1) == 0); // must be even
-    
-    auto r = true;
-    for(int i = 0; i < n; ++i) {
-        auto& player0 = playerVec.at(i);
-        if (player0.flag & 1) continue;
-        r = false;
-        auto name0 = player0.name;
-        player0.flag |= 1;
-        
-        for(int j = i + 1; j < n; ++j) {
-            auto& player1 = playerVec.at(j);
-            if (player1.flag & 1) continue;
-            auto name1 = player1.name;
-            
-            if (pairedSet.find(name0 + "*" + name1) != pairedSet.end()) {
-                continue;
-            }
-            
-            player1.flag |= 1;
-            
-            if (!pairingMatchListRecusive(playerVec, round, pairedSet)) {
-                player1.flag &= ~1;
-                continue;
-            }
-            
-            // random swap to avoid name0 player plays all white side
-            auto swap = rand() & 1;
-            
-            if (type == TourType::swiss) {
-                swap = player0.whiteCnt > player1.whiteCnt;
-            }
-            MatchRecord record(name0, name1, swapPairSides && swap);
-            record.round = round;
-            addMatchRecord(record);
-            return true;
-        }
-        player0.flag &= ~1;
-        
-    }
-    return r;
-}
-
 bool TourMng::pairingMatchList(std::vector<TourPlayer> playerVec, int round)
 {
     if (playerVec.size() < 2) {
@@ -1027,21 +2245,46 @@ bool TourMng::pairingMatchList(std::vector<TourPlayer> playerVec, int round)
                   return lhs.getScore() > rhs.getScore();
               });
     
-    std::set<std::string> pairedSet;
+    // players are identified by their ranks
+    std::unordered_map<std::string, int> rankMap;
+    for(int i = 0; i < int(playerVec.size()); i++) {
+        rankMap[playerVec.at(i).name] = i;
+        playerVec.at(i).whiteCnt = 0;
+    }
+    
+    PlayerPairing pairing(int(playerVec.size()));
     for(auto && m : matchRecordList) {
-        if (m.playernames[0].empty() || m.playernames[1].empty()) continue;
-        pairedSet.insert(m.playernames[0] + "*" + m.playernames[1]);
+        auto itW = rankMap.find(m.playernames[W]), itB = rankMap.find(m.playernames[B]);
+        if (itW == rankMap.end() || itB == rankMap.end()) continue;
+        pairing.setMet(itW->second, itB->second);
+        playerVec.at(itW->second).whiteCnt++;
     }
     
-    if (!pairingMatchListRecusive(playerVec, round, pairedSet)) {
+    std::vector<std::pair<int, int>> pairVec;
+    if (!pairing.pair(pairVec)) {
         std::cout << "Warning: All players have played together already." << std::endl;
-        pairedSet.clear();
-        if (!pairingMatchListRecusive(playerVec, round, pairedSet)) {
+        PlayerPairing freePairing(int(playerVec.size()));
+        if (!freePairing.pair(pairVec)) {
             std::cerr << "Error: cannot pair players." << std::endl;
             return false;
         }
     }
     
+    for(auto && p : pairVec) {
+        auto& player0 = playerVec.at(p.first);
+        auto& player1 = playerVec.at(p.second);
+        
+        // random swap to avoid player0 plays all white side
+        auto swap = rand() & 1;
+        
+        if (type == TourType::swiss) {
+            swap = player0.whiteCnt > player1.whiteCnt;
+        }
+        MatchRecord record(player0.name, player1.name, swapPairSides && swap);
+        record.round = round;
+        addMatchRecord(record);
+    }
+    
     std::string str = "\n" + std::string(tourTypeNames[static_cast<int>(type)]) + " round: " + std::to_string(round + 1);
     if (type == TourType::swiss) {
         str += "/" + std::to_string(swissRounds);
@@ -1167,18 +2410,13 @@ void TourMng::append2TextFile(const std::string& path, const std::string& str)
 void TourMng::shutdown()
 {
     timer.remove(mainTimerId);
+    netNode.close();
     playerMng.shutdown();
 }
 
 int TourMng::uncompletedMatches()
 {
-    auto cnt = 0;
-    for(auto && r : matchRecordList) {
-        if (r.state == MatchState::none) {
-            cnt++;
-        }
-    }
-    return cnt;
+    return matchRecordList.count(MatchState::none);
 }
 
 
@@ -1263,7 +2501,17 @@ bool TourMng::loadMatchRecords(bool autoYesReply)
     
     std::cout << "Tournament resumed!" << std::endl;
     
-    matchRecordList = recordList;
+    matchRecordList.assign(recordList);
+    
+    // all games continue with the opening picked before
+    if (bookMng.getBookSelectType() == BookSelectType::allone) {
+        for(auto && r : matchRecordList) {
+            if (!r.startFen.empty() || !r.startMoves.empty()) {
+                bookMng.setAlloneBook(r.startFen, r.startMoves);
+                break;
+            }
+        }
+    }
     
     auto first = matchRecordList.front();
     
@@ -1303,11 +2551,28 @@ void TourMng::matchCompleted(Game* game)
     if (gIdx >= 0 && gIdx < matchRecordList.size()) {
         auto record = &matchRecordList[gIdx];
         assert(record->state == MatchState::playing);
-        record->state = MatchState::completed;
+        matchRecordList.setState(gIdx, MatchState::completed);
         record->result = game->board.result;
         
+        completedPlySum += game->board.histList.size();
+        completedPlyCnt++;
+        
+        ConcurrencySample sample;
+        sample.timeout = record->result.reason == ReasonType::timeout;
+        
+        // elapsed times include pipe and queue latency, engines using their
+        // full move times pass them by a few milliseconds
+        auto overshootTime = timeController.time + timeController.margin + 0.05;
+        
         EngineStats engineStats[2];
         for(auto && hist : game->board.histList) {
+            if (timeController.mode == TimeControlMode::movetime && hist.elapsed > 0) {
+                sample.moves++;
+                if (hist.elapsed > overshootTime) {
+                    sample.overshootMoves++;
+                }
+            }
+            
             // not for uncomputing moves
             if (hist.nodes == 0) {
                 continue;
@@ -1319,6 +2584,28 @@ void TourMng::matchCompleted(Game* game)
             engineStats[sd].moves++;
         }
         
+        for(int sd = 0; sd < 2; sd++) {
+            sample.names[sd] = game->getPlayer(static_cast<Side>(sd))->getName();
+            if (engineStats[sd].elapsed > 0) {
+                sample.nps[sd] = double(engineStats[sd].nodes) / engineStats[sd].elapsed;
+            }
+        }
+        concurrencyCtrl.addSample(sample);
+        
+        // time out of engine thinking (e.g. loading engines, delays between moves)
+        auto it = matchStartMap.find(gIdx);
+        if (it != matchStartMap.end()) {
+            auto wall = std::chrono::duration<double>(std::chrono::steady_clock::now() - it->second).count();
+            matchOverheadSum += std::max(0.0, wall - engineStats[W].elapsed - engineStats[B].elapsed);
+            matchOverheadCnt++;
+            matchStartMap.erase(it);
+        }
+        matchEstimateChanged = true;
+        
+        if (distMode == DistributedMode::worker) {
+            sendRemoteResult(game, *record, engineStats);
+        }
+        
         for(int sd = 0; sd < 2; sd++) {
             engineStats[sd].games++;
             auto side = static_cast<Side>(sd);
@@ -1383,7 +2670,13 @@ void TourMng::matchCompleted(Game* game)
         }
     }
     
+    // workers leave all of them to the coordinator
+    if (distMode == DistributedMode::worker) {
+        return;
+    }
+    
     checkToExtendMatches(gIdx);
+    checkSprt(gIdx);
     
     saveMatchRecords();
 }
@@ -1613,6 +2906,56 @@ std::string TourMng::createTournamentStats()
         stringStream << "Failed games (timeout, crashed, illegal moves): " << abnormalCnt << " of " << matchRecordList.size();
     }
     
+    auto scoreAdjudicatedCnt = 0, scoreAdjudicatedDrawCnt = 0;
+    for(auto && m : matchRecordList) {
+        if (m.state == MatchState::completed && m.result.reason == ReasonType::scoreadjudication) {
+            scoreAdjudicatedCnt++;
+            if (m.result.result == ResultType::draw) {
+                scoreAdjudicatedDrawCnt++;
+            }
+        }
+    }
+    
+    if (scoreAdjudicatedCnt) {
+        if (abnormalCnt) {
+            stringStream << std::endl;
+        }
+        stringStream << "Score adjudicated games: " << scoreAdjudicatedCnt << " of " << matchRecordList.size()
+        << " (resigns: " << scoreAdjudicatedCnt - scoreAdjudicatedDrawCnt << ", draws: " << scoreAdjudicatedDrawCnt << ")";
+    }
+    
+    if (SyzygyProbeCache::getHitCnt() + SyzygyProbeCache::getMissCnt()) {
+        if (abnormalCnt || scoreAdjudicatedCnt) {
+            stringStream << std::endl;
+        }
+        stringStream << SyzygyProbeCache::toString();
+    }
+    
+    if (sprt.isEnabled()) {
+        stringStream << std::endl << sprt.toString();
+    }
+    
+    if (OutputQueue::getLineCnt()) {
+        stringStream << std::endl << OutputQueue::toString();
+    }
+    
+    auto suppressedString = EngineLogFilter::toString();
+    if (!suppressedString.empty()) {
+        stringStream << std::endl << suppressedString;
+    }
+    
+    if (memoryBudget.isEnabled() && distMode != DistributedMode::coordinator) {
+        stringStream << std::endl << memoryBudget.toString();
+    }
+    
+    if (!makespanList.empty()) {
+        stringStream << std::endl << makespanToString();
+    }
+    
+    if (!workerStatsMap.empty()) {
+        stringStream << std::endl << createWorkerStats();
+    }
+    
     return stringStream.str();
 }
 
@@ -31,6 +31,17 @@
 #include "uciengine.h"
 #include "playermng.h"
 #include "book.h"
+#include "coreslot.h"
+#include "concurrencyctrl.h"
+#include "memorybudget.h"
+#include "sprt.h"
+#include "../base/netnode.h"
+
+#include <array>
+#include <chrono>
+#include <deque>
+#include <functional>
+#include <unordered_map>
 
 #include "../3rdparty/cpptime/cpptime.h"
 
@@ -39,6 +50,16 @@ namespace banksia {
         roundrobin, knockout, swiss, none
     };
     
+    // distributed tournaments: a coordinator owns the matches, workers play them
+    enum class DistributedMode {
+        none, coordinator, worker
+    };
+    
+    // order of starting matches: as listed or the expected-longest ones first
+    enum class MatchOrder {
+        listed, longestfirst
+    };
+    
     class EngineStats {
     public:
         i64 nodes = 0, depths = 0, moves = 0, games = 0;
@@ -85,6 +106,54 @@ namespace banksia {
         int gameIdx = 0, round = 0, pairId;
     };
     
+    // Match records (indexed by gameIdx) with a queue of ready (MatchState::none)
+    // records, indexes by rounds and pairs, and counters of states.
+    // States of records must be changed via setState to keep them all in sync
+    class MatchStore
+    {
+    public:
+        void clear();
+        void assign(const std::vector<MatchRecord>& recordList);
+        void push_back(const MatchRecord& record);
+        
+        bool empty() const { return recordList.empty(); }
+        size_t size() const { return recordList.size(); }
+        
+        MatchRecord& operator[](size_t idx) { return recordList[idx]; }
+        const MatchRecord& operator[](size_t idx) const { return recordList[idx]; }
+        MatchRecord& front() { return recordList.front(); }
+        
+        std::vector<MatchRecord>::iterator begin() { return recordList.begin(); }
+        std::vector<MatchRecord>::iterator end() { return recordList.end(); }
+        std::vector<MatchRecord>::const_iterator begin() const { return recordList.begin(); }
+        std::vector<MatchRecord>::const_iterator end() const { return recordList.end(); }
+        
+        void setState(int gameIdx, MatchState state);
+        
+        // index of the next record to play, -1 if none
+        int popReady();
+        // indexes of the next records to play, without removing them from the queue
+        std::vector<int> peekReady(int n) const;
+        // reorder the queue by keys, higher first, ties keep their order
+        void sortReady(const std::function<double(int)>& keyFunc);
+        // changed whenever records join the queue
+        int getReadyStamp() const { return readyStamp; }
+        
+        int count(MatchState state) const { return stateCnt[static_cast<int>(state)]; }
+        int getLastRound() const { return lastRound; }
+        
+        const std::vector<int>& getPair(int pairId) const;
+        const std::vector<int>& getRound(int round) const;
+        
+    private:
+        void index(int idx);
+        
+        std::vector<MatchRecord> recordList;
+        std::deque<int> readyQueue;
+        std::unordered_map<int, std::vector<int>> pairMap, roundMap;
+        int stateCnt[4] = { 0, 0, 0, 0 }, lastRound = 0, readyStamp = 0;
+    };
+    
     enum class TourState {
         none, playing, done
     };
@@ -111,6 +180,20 @@ namespace banksia {
         TourPlayer pair[2];
     };
     
+    // a worker connection of a coordinator
+    class WorkerInfo {
+    public:
+        std::string name;
+        std::set<int> assignedSet; // gameIdx
+    };
+    
+    class WorkerStats {
+    public:
+        int gameCnt = 0, connectCnt = 0, reissuedCnt = 0;
+        time_t firstTime = 0;
+        bool connected = false;
+    };
+    
     class Elo {
     public:
         Elo(int wins, int draws, int losses);
@@ -142,6 +225,11 @@ namespace banksia {
         std::string createTournamentStats();
         
         void showEgineInOutToScreen(bool enabled);
+        
+        // for the console, the number of concurrent games can be changed anytime
+        void setConcurrency(int n);
+        void setAdaptiveConcurrency(bool enabled);
+        std::string getConcurrencyInfo() const;
         void shutdown();
 
 		static void append2TextFile(const std::string& path, const std::string& str);
@@ -158,6 +246,7 @@ namespace banksia {
         
         void addMatchRecord(MatchRecord& record);
         void addMatchRecord_simple(MatchRecord& record);
+        void assignOpening(MatchRecord& record);
 
         void finishTournament();
         
@@ -171,10 +260,11 @@ namespace banksia {
         // for all
         bool pairingMatchList(const std::vector<std::string>& nameList);
         bool pairingMatchList(std::vector<TourPlayer> playerVec, int round);
-        bool pairingMatchListRecusive(std::vector<TourPlayer>& playerVec, int round, const std::set<std::string>& pairedSet);
 
         // Knockout
-        std::vector<TourPlayer> getKnockoutWinnerList();
+        bool collectKnockoutPair(int pairId, TourPlayerPair& playerPair) const;
+        std::string getKnockoutPairWinner(int pairId) const;
+        int createReadyKnockoutMatches(std::string* champion);
         bool createNextKnockoutMatchList();
 
         // Swiss
@@ -184,6 +274,44 @@ namespace banksia {
         void matchCompleted(Game* game);
         bool addGame(Game* game);
         
+        // distributed tournaments
+        bool startNetwork();
+        void processNetMessages();
+        void coordinatorMessage(const NetMessage& msg);
+        void workerMessage(const NetMessage& msg);
+        void requestRemoteMatches();
+        void sendRemoteResult(Game* game, const MatchRecord& record, const EngineStats* engineStats);
+        void remoteMatchCompleted(const NetMessage& msg);
+        std::string createWorkerStats() const;
+        bool sendNetMessage(int connId, Json::Value data);
+        bool isNetMessageAuthorized(const NetMessage& msg) const;
+        
+        // start engines of next matches before their slots are free
+        void prepareNextMatches();
+        void releaseStandbyEngines(int gameIdx);
+        
+        // SPRT on game pairs of the first player, stop when it accepts or rejects
+        void initSprt();
+        bool addSprtPair(int pairId);
+        void checkSprt(int gIdx);
+        void updateSprt();
+        
+        // engines unchanged since the JSON maker probed them skip parsing their options
+        void markTrustedProfiles(const std::string& cachePath);
+        
+        // measure engines and fit hash, concurrency into the memory budget
+        void sampleEngineMemory();
+        void updateMemoryBudget();
+        
+        // expected durations of matches, from engine stats or the time control
+        void updateMatchEstimates();
+        double estimateMatchDuration(const MatchRecord& record) const;
+        void orderReadyMatches();
+        bool isReadyOrderStale() const;
+        void planMakespan();
+        void finishMakespan();
+        std::string makespanToString() const;
+        
         void tickWork() override;
         
         void matchLog(const std::string& line, bool verbose);
@@ -202,7 +330,7 @@ namespace banksia {
         bool shufflePlayers = false;
 
         std::vector<std::string> participantList;
-        std::vector<MatchRecord> matchRecordList;
+        MatchStore matchRecordList;
         std::vector<Game*> gameList;
         PlayerMng playerMng;
         BookMng bookMng;
@@ -218,6 +346,64 @@ namespace banksia {
     private:
         int gameConcurrency = 1, gameperpair = 1, swissRounds = 6;
         bool resumable = true, swapPairSides = true;
+        
+        // pin engines of each game to a separate set of cores
+        bool corePinningMode = false;
+        CoreSlotMng coreSlotMng;
+        
+        // change the number of concurrent games by feedbacks of games and computer load
+        bool adaptiveConcurrencyMode = false;
+        int concurrencyMin = 1, concurrencyMax = 0;
+        ConcurrencyController concurrencyCtrl;
+        
+        Sprt sprt;
+        std::string sprtPlayer;
+        
+        // keep hash and concurrency within the computer memory
+        MemoryBudget memoryBudget;
+        int memoryTickCnt = 0;
+        
+        // expected seconds of a game for each engine, the default is for unknown ones
+        MatchOrder matchOrder = MatchOrder::listed;
+        std::map<std::string, double> engineGameTimeMap;
+        double defaultEngineGameTime = 0, matchOverheadSum = 0;
+        int matchOverheadCnt = 0;
+        int readyStamp = -1;
+        bool matchEstimateChanged = true;
+        // the game times the ready queue was last sorted by
+        std::map<std::string, double> sortedEngineGameTimeMap;
+        double sortedDefaultEngineGameTime = 0;
+        
+        // planned (list scheduling of the estimates) vs actual makespan of each batch of matches
+        std::map<int, std::chrono::steady_clock::time_point> matchStartMap;
+        std::chrono::steady_clock::time_point makespanStart;
+        bool makespanPlanning = false, makespanFromStats = false;
+        double plannedMakespan = 0;
+        std::vector<std::pair<double, double>> makespanList;
+        
+        // engines started in advance for next matches, by gameIdx
+        int prestartGames = 0, maxEngineLaunches = 2;
+        std::map<int, std::array<Engine*, 2>> standbyEngineMap;
+        i64 completedPlySum = 0;
+        int completedPlyCnt = 0;
+        
+        // distributed tournaments
+        DistributedMode distMode = DistributedMode::none;
+        std::string distHost = "127.0.0.1", distBind = "127.0.0.1", distToken, workerName;
+        int distPort = 16161, distBatch = 2;
+        NetNode netNode;
+        
+        // coordinator: workers by connections, stats by names
+        std::map<int, WorkerInfo> workerConnMap;
+        std::map<std::string, WorkerStats> workerStatsMap;
+        
+        // worker: local gameIdx -> coordinator gameIdx
+        int coordinatorConnId = -1, reconnectDelay = 1;
+        bool connecting = false, pullPending = false;
+        time_t lastConnectTime = 0, lastEmptyAssignTime = 0;
+        std::map<int, int> remoteGameIdxMap;
+        // results by coordinator gameIdx, kept until acknowledged
+        std::map<int, Json::Value> resultOutbox;
 
         static void showPathInfo(const std::string& name, const std::string& path, bool mode);
         
@@ -228,6 +414,7 @@ namespace banksia {
         
         // endgame
         std::string syzygyPath;
+        bool syzygyLazyMode = false;
         
         GameConfig gameConfig;
 
@@ -253,6 +440,7 @@ namespace banksia {
         bool logEngineAllInOneMode = false, logEngineMode = false;
         bool logEngineShowTime = false, logEngineGameTitleSurfix = false;
         bool logEngineBySides = false;
+        LogVerbosity logEngineVerbosity = LogVerbosity::all;
 
         bool logScreenEngineInOutMode = false;
     };
@@ -23,7 +23,6 @@
  */
 
 
-#include <regex>
 #include <map>
 
 #include "uciengine.h"
@@ -53,6 +52,7 @@ std::string UciEngine::protocolString() const
 
 bool UciEngine::sendOptions()
 {
+    std::vector<std::string> vec;
     for(auto && option : config.optionList) {
         if (!isWritable()) {
             return false;
@@ -63,10 +63,22 @@ bool UciEngine::sendOptions()
             continue;
         }
         
-        std::string str = "setoption name " + o.name + " value " + o.getValueAsString();
-        write(str);
+        if (o.type == OptionType::spin) {
+            auto name = o.name;
+            toLower(name);
+            if (name == "hash") {
+                hashSize = o.value;
+            }
+        }
+        
+        vec.push_back("setoption name " + o.name + " value " + o.getValueAsString());
     }
-    return true;
+    
+    // the answer tells when all options are set
+    vec.push_back("isready");
+    setupCommandSent();
+    pingSent();
+    return write(vec);
 }
 
 void UciEngine::newGame()
@@ -75,6 +87,7 @@ void UciEngine::newGame()
     ponderingMove = MoveFull::illegalMove;
     expectingBestmove = false;
     computingState = EngineComputingState::idle;
+    setupCommandSent();
     if (write("ucinewgame")) {
         setState(PlayerState::playing);
     }
@@ -126,7 +139,9 @@ bool UciEngine::go()
         assert(expectingBestmove);
         if (!board->histList.empty() && board->histList.back().move == ponderingMove) {
             computingState = EngineComputingState::thinking;
-            write("ponderhit");
+            if (write("ponderhit")) {
+                goTime = writeTime;
+            }
             return true;
         }
         return stop();
@@ -135,8 +150,11 @@ bool UciEngine::go()
     assert(!expectingBestmove && computingState == EngineComputingState::idle);
     expectingBestmove = true;
     computingState = EngineComputingState::thinking;
-    auto goString = getGoString(MoveFull::illegalMove);
-    return write(goString);
+    if (!write({ getPositionString(MoveFull::illegalMove), "go " + timeControlString() })) {
+        return false;
+    }
+    goTime = writeTime;
+    return true;
 }
 
 std::string UciEngine::getPositionString(const Move& pondermove) const
@@ -216,6 +234,7 @@ std::string UciEngine::timeControlString() const
 
 bool UciEngine::sendPing()
 {
+    pingSent();
     return write("isready");
 }
 
@@ -231,6 +250,10 @@ void UciEngine::parseLine(int cmdInt, const std::string& cmdString, const std::s
     auto cmd = static_cast<UciEngineCmd>(cmdInt);
     switch (cmd) {
         case UciEngineCmd::option:
+            // the option list is known from the profile
+            if (config.trustedProfile) {
+                break;
+            }
             if (!parseOption(line)) {
                 write("Unknown option " + line);
             }
@@ -279,17 +302,23 @@ void UciEngine::parseLine(int cmdInt, const std::string& cmdString, const std::s
             break;
         }
 
+        case UciEngineCmd::readyok:
+            pongReceived();
+            break;
+
         case UciEngineCmd::uciok:
         {
             setState(PlayerState::ready);
             expectingBestmove = false;
             sendOptions();
-            sendPing();
             break;
         }
 
         case UciEngineCmd::theId:
         {
+            if (config.trustedProfile) {
+                break;
+            }
             auto vec = splitString(line, ' ');
             if (vec.size() <= 2) {
                 return;
@@ -316,113 +345,117 @@ bool UciEngine::parseOption(const std::string& s)
 {
     assert(!s.empty());
     
-    static const std::regex re("option name (.*) type (combo|spin|button|check|string)(.*)");
+    Option option;
+    if (!parseOptionLine(s, option)) {
+        return false;
+    }
+    config.updateOption(option);
+    return true;
+}
+
+// option name NAME type TYPE [default VALUE] [min VALUE] [max VALUE] [var VALUE]...
+// A value runs until the next keyword, thus names and values may have spaces.
+// The default of a string option runs to the end of the line
+bool UciEngine::parseOptionLine(const std::string& line, Option& option)
+{
+    enum class Key {
+        none, name, type, theDefault, min, max, var
+    };
     
-    try {
-        std::smatch match;
-        if (std::regex_search(s, match, re) && match.size() > 1) {
-            Option option;
-            option.name = match.str(1);
-            auto type = match.str(2);
-            
-            if (type == "button") {
-                option.type = OptionType::button;
-                config.updateOption(option);
-                return true;
-            }
-            
-            std::string rest = match.str(3);
-            
-            auto pDefault = rest.find("default");
-            
-            if (type == "string" || type == "check") {
-                if (type == "check") {
-                    option.type = OptionType::check;
-                    bool b = rest.find("true") != std::string::npos;
-                    option.setDefaultValue(b);
-                } else {
-                    option.type = OptionType::string;
-                    std::string str;
-                    if (pDefault != std::string::npos) {
-                        str = pDefault + 8 >= rest.size() ? "" : rest.substr(pDefault + 8);
-                        if (str == "<empty>") {
-                            str = "";
-                        }
-                    }
-                    option.setDefaultValue(str);
-                }
-                if (option.isValid()) {
-                    config.updateOption(option);
-                    return true;
-                }
-                return false;
-            }
-            
-            if (rest.empty() || match.size() <= 3 || pDefault == std::string::npos) {
-                return false;
-            }
-            
-            if (type == "spin") {
-                static const std::regex re("(.*)default (.+) min (.+) max (.+)");
-                if (std::regex_search(rest, match, re) && match.size() > 4) {
-                    auto dString = match.str(2);
-                    auto minString = match.str(3);
-                    auto maxString = match.str(4);
-                    auto dInt = std::atoi(dString.c_str()), minInt = std::atoi(minString.c_str()), maxInt = std::atoi(maxString.c_str());
-                    
-                    option.type = OptionType::spin;
-                    option.setDefaultValue(dInt, minInt, maxInt);
-                    if (option.isValid()) {
-                        config.updateOption(option);
-                        return true;
-                    }
-                }
-                return false;
-            }
-            
-            if (type == "combo") {
-                auto p = rest.find("default");
-                std::string defaultString;
-                std::vector<std::string> list;
-                if (p != std::string::npos && rest.find("var") != std::string::npos) {
-                    p += 8;
-                    for(int i = 0; ; i++) {
-                        auto q = rest.find("var", p);
-                        auto len = (q != std::string::npos ? q : rest.length()) - p;
-                        auto str = rest.substr(p, len);
-                        trim(str);
-                        if (str.empty()) break;
-                        if (i == 0) {
-                            defaultString = str;
-                        } else {
-                            list.push_back(str);
-                        }
-                        
-                        if (q == std::string::npos) break;
-                        p = q + 4;
-                    }
-                    
-                    if (!list.empty()) {
-                        option.type = OptionType::combo;
-                        option.setDefaultValue(defaultString, list);
-                        
-                        if (option.isValid()) {
-                            config.updateOption(option);
-                            return true;
-                        }
-                        
-                    }
-                }
-                return false;
-            }
-        } else {
+    std::string name, type, defaultString, minString, maxString;
+    std::vector<std::string> vars;
+    
+    auto key = Key::none;
+    size_t valueStart = 0, valueEnd = 0;
+    
+    auto store = [&]() {
+        auto str = line.substr(valueStart, valueEnd - valueStart);
+        switch (key) {
+            case Key::name: name = str; break;
+            case Key::type: type = str; break;
+            case Key::theDefault: defaultString = str; break;
+            case Key::min: minString = str; break;
+            case Key::max: maxString = str; break;
+            case Key::var:
+                if (!str.empty()) vars.push_back(str);
+                break;
+            default:
+                break;
+        }
+        valueStart = valueEnd = 0;
+    };
+    
+    auto isWord = [&](size_t k, size_t len, const char* word) {
+        return line.compare(k, len, word) == 0;
+    };
+    
+    for(size_t i = 0, n = line.size(); i < n; ) {
+        while (i < n && line[i] == ' ') i++;
+        if (i >= n) break;
+        auto k = i;
+        while (i < n && line[i] != ' ') i++;
+        auto len = i - k;
+        
+        auto newKey = Key::none;
+        if (key == Key::none) {
+            if (isWord(k, len, "name")) newKey = Key::name;
+        } else if (key == Key::name) {
+            if (isWord(k, len, "type")) newKey = Key::type;
+        } else if (key != Key::theDefault || type != "string") {
+            if (isWord(k, len, "default")) newKey = Key::theDefault;
+            else if (isWord(k, len, "min")) newKey = Key::min;
+            else if (isWord(k, len, "max")) newKey = Key::max;
+            else if (isWord(k, len, "var")) newKey = Key::var;
+        }
+        
+        if (newKey != Key::none) {
+            store();
+            key = newKey;
+            continue;
+        }
+        
+        if (key == Key::none) { // "option"
+            continue;
+        }
+        if (valueEnd == 0) {
+            valueStart = k;
         }
-    } catch (std::regex_error& e) {
-        // Syntax error in the regular expression
-        std::cout << "Error: " << e.what() << std::endl;
+        valueEnd = i;
     }
+    store();
     
-    return false;
+    if (name.empty()) {
+        return false;
+    }
+    option.name = name;
+    
+    if (type == "button") {
+        option.type = OptionType::button;
+        return true;
+    }
+    
+    if (type == "check") {
+        option.type = OptionType::check;
+        option.setDefaultValue(defaultString == "true");
+    } else if (type == "string") {
+        option.type = OptionType::string;
+        option.setDefaultValue(defaultString == "<empty>" ? "" : defaultString);
+    } else if (type == "spin") {
+        if (defaultString.empty() || minString.empty() || maxString.empty()) {
+            return false;
+        }
+        option.type = OptionType::spin;
+        option.setDefaultValue(std::atoi(defaultString.c_str()), std::atoi(minString.c_str()), std::atoi(maxString.c_str()));
+    } else if (type == "combo") {
+        if (vars.empty()) {
+            return false;
+        }
+        option.type = OptionType::combo;
+        option.setDefaultValue(defaultString, vars);
+    } else {
+        return false;
+    }
+    return option.isValid();
 }
 
 bool UciEngine::parseInfo(const std::string& line)
@@ -459,14 +492,17 @@ bool UciEngine::parseInfo(const std::string& line)
             ++i;
             auto s = vec.at(i);
             
-            auto iscpscore = false;
-            if (s == "cp") {
-                iscpscore = true;
+            auto iscpscore = false, ismatescore = false;
+            if (s == "cp" || s == "mate") {
+                iscpscore = s == "cp";
+                ismatescore = !iscpscore;
                 ++i;
                 s = vec.at(i);
             }
             score = std::atoi(s.c_str());
-            if (!iscpscore) score *= 100;
+            if (ismatescore) {
+                score = score > 0 ? MateScore - score : -MateScore - score;
+            } else if (!iscpscore) score *= 100;
             continue;
         }
 
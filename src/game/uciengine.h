@@ -52,6 +52,8 @@ namespace banksia {
         virtual void newGame() override;
         
         virtual bool sendPing() override;
+        // the protocol requires answering isready immediately, even while searching
+        virtual bool isPingableWhileThinking() const override { return true; }
         virtual bool sendPong();
         
         virtual bool goPonder(const Move& pondermove) override;
@@ -70,6 +72,9 @@ namespace banksia {
         
         virtual bool sendOptions();
         
+    public:
+        static bool parseOptionLine(const std::string& line, Option& option);
+        
     private:
         std::string timeControlString() const;
         bool parseOption(const std::string& str);
@@ -23,7 +23,6 @@
  */
 
 
-#include <regex>
 
 #include "wbengine.h"
 
@@ -118,31 +117,33 @@ void WbEngine::newGame_straight()
 {
     assert(getState() == PlayerState::ready);
     computingState = EngineComputingState::idle;
+    setupCommandSent();
     
     sendMemoryAndCoreOptions();
     
-    write(ponderMode ? "hard" : "easy");
-    write("post");
+    std::vector<std::string> vec;
+    vec.push_back(ponderMode ? "hard" : "easy");
+    vec.push_back("post");
 
     if (isFeatureOn("reuse", true)) {
-        write("new");
+        vec.push_back("new");
     }
     
     if (!board->fromOriginPosition()) {
-        write("setboard " + board->getStartingFen());
+        vec.push_back("setboard " + board->getStartingFen());
     }
     
     if (!board->histList.empty()) {
         // TODO: check logic again. No ping here
         // force to avoid some engines such as Crafty auto computing
-        write("force");
+        vec.push_back("force");
         for (auto && hist : board->histList) {
-            std::string str = move2String(hist.move, hist.moveString);
-            write(str);
+            vec.push_back(move2String(hist.move, hist.moveString));
         }
     }
     
-    write(timeControlString());
+    vec.push_back(timeControlString());
+    write(vec);
     
     if (feature_ping) {
         // fake ping to avoid other cmd be run
@@ -188,7 +189,11 @@ bool WbEngine::go_straight()
     Engine::go();
     computingState = EngineComputingState::thinking;
     
-    return write(timeLeftString()) && write("go");
+    if (!write({ timeLeftString(), "go" })) {
+        return false;
+    }
+    goTime = writeTime;
+    return true;
 }
 
 std::string WbEngine::timeLeftString() const
@@ -263,6 +268,7 @@ bool WbEngine::sendPing()
 {
     assert(feature_ping);
     expectingPongCnt++;
+    pingSent();
     return write("ping " + std::to_string(++pingCnt));
 }
 
@@ -299,7 +305,7 @@ void WbEngine::tickPing()
     }
     
     tick_ping++;
-    if (tick_ping >= tick_period_ping) {
+    if (tick_ping >= getPingPeriod() && pingSentTime == 0) {
         resetPing();
         sendPing();
     } else {
@@ -337,6 +343,9 @@ bool WbEngine::sendMemoryAndCoreOptions()
         }
         if (option.isValid()) {
             str += option.name + " " + option.getValueAsString();
+            if (option.type == OptionType::spin) {
+                hashSize = option.value;
+            }
         }
     }
     if (isFeatureOn("smp")) {
@@ -430,46 +439,30 @@ bool WbEngine::parseFeature(const std::string& name, const std::string& content,
     return true;
 }
 
+// feature NAME=VALUE NAME="VALUE WITH SPACES" ...
 void WbEngine::parseFeatures(const std::string& line)
 {
-    // "feature " length = 8
-    std::string featureName;
-    for(size_t i = 8, k = -1, quote = 0; i < line.size(); i++) {
-        auto ch = line[i];
-        if (ch == '=') {
-            if (k < 0 || i <= k) break; // somethings wrong
-            featureName = line.substr(k, i - k);
-            k = i + 1;
+    auto n = line.size();
+    auto i = std::min(line.find(' '), n); // skip "feature"
+    while (i < n) {
+        while (i < n && line[i] == ' ') i++;
+        auto k = i;
+        while (i < n && line[i] != '=' && line[i] != ' ') i++;
+        if (i >= n || line[i] != '=') { // a word without value
             continue;
         }
-        if (ch == '"') {
-            if (quote == 0) {
-                quote++;
-                k = i + 1;
-            } else {
-                if (!featureName.empty() && k > 0 && i > k + 1) {
-                    auto content = line.substr(k, i - k);
-                    parseFeature(featureName, content, true);
-                }
-                featureName = "";
-                quote = 0;
-                k = -1;
-                continue;
-            }
-        }
-        if ((ch == ' ' || i + 1 == line.size()) && quote == 0) {
-            if (!featureName.empty() && k > 0) {
-                auto len = i - k;
-                if (i + 1 == line.size()) len++;
-                auto content = line.substr(k, len);
-                parseFeature(featureName, content, false);
-            }
-            featureName = "";
-            quote = 0;
-            k = -1;
-            continue;
+        
+        auto featureName = line.substr(k, i - k);
+        i++;
+        if (i < n && line[i] == '"') {
+            auto q = std::min(line.find('"', i + 1), n);
+            parseFeature(featureName, line.substr(i + 1, q - i - 1), true);
+            i = q + 1;
+        } else {
+            k = i;
+            while (i < n && line[i] != ' ') i++;
+            parseFeature(featureName, line.substr(k, i - k), false);
         }
-        if (k < 0) k = i;
     }
 }
 
@@ -490,10 +483,8 @@ std::string WbEngine::move2String(const Move& move, const std::string& sanMoveSt
 
 bool WbEngine::oppositeMadeMove(const Move& move, const std::string& sanMoveString)
 {
-    write("force"); // we don't want this engine starts calculating after this move
-    
-    std::string str = move2String(move, sanMoveString);
-    return write(str);
+    // force: we don't want this engine starts calculating after this move
+    return write({ "force", move2String(move, sanMoveString) });
 }
 
 bool WbEngine::engineMove(const std::string& moveString, bool mustSend)
@@ -589,6 +580,7 @@ void WbEngine::parseLine(int cmdInt, const std::string& cmdString, const std::st
         {
             expectingPongCnt = 0;
             pongCnt++;
+            pongReceived();
 
             if (getState() == PlayerState::ready) {
                 setState(PlayerState::playing);
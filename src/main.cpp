@@ -23,14 +23,17 @@
  */
 
 #include <csignal>
+#include <iomanip>
 
 #include "game/jsonmaker.h"
 #include "game/tourmng.h"
+#include "game/uciengine.h"
 
 #include "3rdparty/fathom/tbprobe.h"
 
 void show_usage(std::string name);
 void show_help();
+void bench_option_parsing();
 
 
 
@@ -89,6 +92,10 @@ int main(int argc, const char * argv[])
     if (argmap.find("-v") != argmap.end()) {
         banksia::banksiaVerbose = argmap["-v"] == "on";
     }
+    if (argmap.find("-bench") != argmap.end()) {
+        bench_option_parsing();
+        return 0;
+    }
     if (argmap.find("-profile") != argmap.end()) {
 #ifdef _WIN32
         banksia::profileMode = true;
@@ -162,6 +169,22 @@ int main(int argc, const char * argv[])
             continue;
         }
         
+        if (cmd == "concurrency") {
+            if (vec.size() < 2) {
+                std::cout << tourMng.getConcurrencyInfo() << std::endl;
+            } else if (vec[1] == "auto") {
+                tourMng.setAdaptiveConcurrency(true);
+            } else {
+                auto n = std::atoi(vec[1].c_str());
+                if (n > 0) {
+                    tourMng.setConcurrency(n);
+                } else {
+                    std::cerr << "Error: concurrency must be a positive number or auto" << std::endl;
+                }
+            }
+            continue;
+        }
+        
         if (cmd == "quit") {
             break;
         }
@@ -201,6 +224,7 @@ void show_usage(std::string name)
     << "               banksia -u -d c:\\myengines, will create engines.json and tour.json files at the folder where\n"
     << "               banksia.exe is located. banksia will search the engines located in c:\\myengines in this case.\n"
     << "  -v on|off    turn on/off verbose (default on)\n"
+    << "  -bench       benchmark parsing a very large list of engine options\n"
     
 #ifdef _WIN32
     << "  -profile     profile engines (cpu, mem, threads)\n"
@@ -229,9 +253,58 @@ void show_help()
     << "  help                    show this help message\n"
     << "  status                  current result\n"
     << "  v [on|off]              verbose on/off. Show/Don't show individual match (default on)\n"
+    << "  concurrency [N|auto]    show/set the number of concurrent games, auto: adaptive\n"
     << "  quit                    quit\n"
     << std::endl;
 }
 
-
-
+// Parses a very large option list as sent by an engine with many parameters
+void bench_option_parsing()
+{
+    const int optionCnt = 20000, roundCnt = 10;
+    
+    std::vector<std::string> lines;
+    for(int i = 0; i < optionCnt; i++) {
+        auto name = "Param " + std::to_string(i) + " Of Search";
+        switch (i % 5) {
+            case 0:
+                lines.push_back("option name " + name + " type spin default " + std::to_string(i) + " min -1000 max 100000");
+                break;
+            case 1:
+                lines.push_back("option name " + name + " type check default " + (i % 2 ? "true" : "false"));
+                break;
+            case 2:
+                lines.push_back("option name " + name + " type string default <empty>");
+                break;
+            case 3:
+                lines.push_back("option name " + name + " type combo default Normal Mode var Solid var Normal Mode var Risky");
+                break;
+            default:
+                lines.push_back("option name " + name + " type button");
+                break;
+        }
+    }
+    
+    size_t bytes = 0;
+    for(auto && line : lines) {
+        bytes += line.size();
+    }
+    
+    auto okCnt = 0;
+    auto start = std::chrono::steady_clock::now();
+    for(int r = 0; r < roundCnt; r++) {
+        for(auto && line : lines) {
+            banksia::Option option;
+            if (banksia::UciEngine::parseOptionLine(line, option)) {
+                okCnt++;
+            }
+        }
+    }
+    auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    
+    auto lineCnt = double(optionCnt) * roundCnt;
+    std::cout << std::fixed << std::setprecision(3)
+    << "Option parsing: " << optionCnt << " options x " << roundCnt << " rounds, parsed " << okCnt
+    << ", elapsed " << elapsed << "s, " << std::setprecision(0) << lineCnt / std::max(elapsed, 1e-9) << " options/s, "
+    << std::setprecision(1) << double(bytes) * roundCnt / std::max(elapsed, 1e-9) / (1024 * 1024) << " MB/s" << std::endl;
+}